@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "baseline.h"
+
+using namespace std;
+
+// minimal JSON reader, only what is needed to read back the lv2bm reports:
+// the numbers and strings are stored by their path, arrays append to the path
+struct json_parser_t {
+    const char *p;
+    baseline_entry_t *entry;
+    std::map<std::string, std::string> strings;
+};
+
+static bool parse_value(json_parser_t *parser, const std::string & path);
+
+static void skip_spaces(json_parser_t *parser)
+{
+    while (*parser->p == ' ' || *parser->p == '\t' || *parser->p == '\r' || *parser->p == '\n')
+        parser->p++;
+}
+
+static bool parse_string(json_parser_t *parser, std::string *str)
+{
+    if (*parser->p != '"')
+        return false;
+
+    parser->p++;
+    while (*parser->p && *parser->p != '"') {
+        char c = *parser->p++;
+        if (c == '\\') {
+            c = *parser->p++;
+            switch (c) {
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case 'r': c = '\r'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'u':
+                // only the control characters are escaped by the reports
+                if (strlen(parser->p) < 4) return false;
+                c = (char) strtol(std::string(parser->p, 4).c_str(), NULL, 16);
+                parser->p += 4;
+                break;
+            case '\0': return false;
+            }
+        }
+        str->push_back(c);
+    }
+
+    if (*parser->p != '"')
+        return false;
+
+    parser->p++;
+    return true;
+}
+
+static bool parse_object(json_parser_t *parser, const std::string & path)
+{
+    parser->p++;
+    skip_spaces(parser);
+    if (*parser->p == '}') {
+        parser->p++;
+        return true;
+    }
+
+    while (true) {
+        std::string key;
+        skip_spaces(parser);
+        if (!parse_string(parser, &key))
+            return false;
+
+        skip_spaces(parser);
+        if (*parser->p++ != ':')
+            return false;
+
+        if (!parse_value(parser, path.empty() ? key : path + "." + key))
+            return false;
+
+        skip_spaces(parser);
+        char c = *parser->p++;
+        if (c == '}') return true;
+        if (c != ',') return false;
+    }
+}
+
+static bool parse_array(json_parser_t *parser, const std::string & path)
+{
+    parser->p++;
+    skip_spaces(parser);
+    if (*parser->p == ']') {
+        parser->p++;
+        return true;
+    }
+
+    while (true) {
+        if (!parse_value(parser, path))
+            return false;
+
+        skip_spaces(parser);
+        char c = *parser->p++;
+        if (c == ']') return true;
+        if (c != ',') return false;
+    }
+}
+
+static bool parse_value(json_parser_t *parser, const std::string & path)
+{
+    skip_spaces(parser);
+
+    const char *p = parser->p;
+    if (*p == '{') return parse_object(parser, path);
+    if (*p == '[') return parse_array(parser, path);
+
+    if (*p == '"') {
+        std::string str;
+        if (!parse_string(parser, &str))
+            return false;
+        parser->strings[path] = str;
+        return true;
+    }
+
+    if (strncmp(p, "true", 4) == 0 || strncmp(p, "null", 4) == 0) {
+        parser->entry->numbers[path].push_back(*p == 't' ? 1.0 : NAN);
+        parser->p += 4;
+        return true;
+    }
+
+    if (strncmp(p, "false", 5) == 0) {
+        parser->entry->numbers[path].push_back(0.0);
+        parser->p += 5;
+        return true;
+    }
+
+    char *end;
+    double value = strtod(p, &end);
+    if (end == p)
+        return false;
+
+    parser->entry->numbers[path].push_back(value);
+    parser->p = end;
+    return true;
+}
+
+Baseline::Baseline(const char *path)
+{
+    this->path = path;
+    this->threshold = 5.0;
+    this->alpha = 0.01;
+
+    FILE *file = fopen(path, "r");
+    if (!file)
+        throw std::runtime_error(std::string("Can't open the baseline file ") + path);
+
+    // one JSON object per line
+    std::string line;
+    uint32_t line_number = 0;
+    int c;
+    do {
+        c = fgetc(file);
+        if (c != EOF && c != '\n') {
+            line.push_back(c);
+            continue;
+        }
+
+        line_number++;
+        if (line.find_first_not_of(" \t\r") != std::string::npos)
+            parse_line(line.c_str(), line_number);
+        line.clear();
+    } while (c != EOF);
+
+    fclose(file);
+}
+
+void Baseline::parse_line(const char *line, uint32_t line_number)
+{
+    baseline_entry_t entry;
+    json_parser_t parser;
+    parser.p = line;
+    parser.entry = &entry;
+
+    skip_spaces(&parser);
+    if (*parser.p != '{' || !parse_value(&parser, "")) {
+        cerr << "warning: invalid JSON at line " << line_number << " of " << path << endl;
+        return;
+    }
+
+    // records of plugins which failed and scaling records have no results
+    if (parser.strings.count("error") || !parser.strings.count("uri") || !entry.numbers.count("rate"))
+        return;
+
+    entry.uri = parser.strings["uri"];
+    entry.signal = parser.strings["signal"];
+    entry.rate = entry.numbers["rate"].empty() ? 0 : entry.numbers["rate"][0];
+    entry.frame_size = entry.numbers["frame_size"].empty() ? 0 : entry.numbers["frame_size"][0];
+    entry.n_frames = entry.numbers["n_frames"].empty() ? 0 : entry.numbers["n_frames"][0];
+
+    entries.push_back(entry);
+}
+
+baseline_entry_t *Baseline::find(const char *uri, uint32_t rate, uint32_t frame_size)
+{
+    // the last result of the URI wins, zero rate or frame size match any
+    for (uint32_t i = entries.size(); i > 0; i--) {
+        baseline_entry_t *entry = &entries[i-1];
+        if (entry->uri == uri && (rate == 0 || entry->rate == rate) &&
+            (frame_size == 0 || entry->frame_size == frame_size))
+            return entry;
+    }
+
+    return NULL;
+}
+
+double Baseline::median(std::vector<float> samples)
+{
+    if (samples.empty())
+        return NAN;
+
+    uint32_t middle = samples.size() / 2;
+    std::nth_element(samples.begin(), samples.begin() + middle, samples.end());
+    double value = samples[middle];
+
+    if (samples.size() % 2 == 0) {
+        value += *std::max_element(samples.begin(), samples.begin() + middle);
+        value /= 2.0;
+    }
+
+    return value;
+}
+
+double Baseline::mann_whitney(const std::vector<float> & baseline, const std::vector<float> & current)
+{
+    // one-sided test, the alternative hypothesis is that the current cycles take longer
+    double n1 = baseline.size(), n2 = current.size(), n = n1 + n2;
+
+    std::vector< std::pair<float, bool> > samples;
+    samples.reserve(n);
+    for (uint32_t i = 0; i < baseline.size(); i++) samples.push_back(std::make_pair(baseline[i], false));
+    for (uint32_t i = 0; i < current.size(); i++) samples.push_back(std::make_pair(current[i], true));
+    std::sort(samples.begin(), samples.end());
+
+    // ranks sum of the current samples, the ties get the average rank
+    double rank_sum = 0.0, ties = 0.0;
+    for (uint32_t i = 0; i < samples.size();) {
+        uint32_t j = i;
+        while (j < samples.size() && samples[j].first == samples[i].first) j++;
+
+        double t = j - i;
+        double rank = (i + 1 + j) / 2.0;
+        for (uint32_t k = i; k < j; k++) {
+            if (samples[k].second) rank_sum += rank;
+        }
+
+        ties += t * t * t - t;
+        i = j;
+    }
+
+    double u = rank_sum - n2 * (n2 + 1.0) / 2.0;
+    double mean = n1 * n2 / 2.0;
+    double variance = n1 * n2 / 12.0 * ((n + 1.0) - ties / (n * (n - 1.0)));
+    if (variance <= 0.0)
+        return 1.0;
+
+    // normal approximation with continuity correction, the cycle counts are large
+    double z = (u - mean - 0.5) / sqrt(variance);
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+std::vector<comparison_t> Baseline::compare(Bench *bench)
+{
+    std::vector<comparison_t> comparisons;
+
+    baseline_entry_t *entry = find(bench->plugin->uri.c_str(), bench->sample_rate, bench->frame_size);
+    if (!entry)
+        return comparisons;
+
+    const char *names[] = {"min", "def", "max"};
+    bench_info_t *tests[] = {&bench->min, &bench->def, &bench->max};
+
+    for (uint32_t i = 0; i < 3; i++) {
+        std::vector<double> & values = entry->numbers[std::string("tests.") + names[i] + ".cycles"];
+        if (values.size() < 2 || tests[i]->cycles.size() < 2)
+            continue;
+
+        std::vector<float> baseline(values.begin(), values.end());
+
+        comparison_t comparison;
+        comparison.test = names[i];
+        comparison.baseline = median(baseline);
+        comparison.current = median(tests[i]->cycles);
+        comparison.delta = (comparison.current / comparison.baseline - 1.0) * 100.0;
+        comparison.p_value = mann_whitney(baseline, tests[i]->cycles);
+
+        // statistically significant and bigger than the noise we accept
+        comparison.regression = comparison.p_value < alpha && comparison.delta > threshold;
+
+        comparisons.push_back(comparison);
+    }
+
+    return comparisons;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BASELINE_H
+#define BASELINE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "bm.h"
+
+// result of a previous run, loaded from a JSON report
+struct baseline_entry_t {
+    std::string uri, signal;
+    uint32_t rate, frame_size, n_frames;
+
+    // flattened JSON values, the keys are the paths (e.g. "tests.def.cycles")
+    std::map<std::string, std::vector<double> > numbers;
+};
+
+// difference between the current and the baseline cycles of a test
+struct comparison_t {
+    const char *test;
+    double baseline, current, delta, p_value;
+    bool regression;
+};
+
+class Baseline {
+private:
+    void parse_line(const char *line, uint32_t line_number);
+
+public:
+    Baseline(const char *path);
+
+    baseline_entry_t *find(const char *uri, uint32_t rate=0, uint32_t frame_size=0);
+    std::vector<comparison_t> compare(Bench *bench);
+
+    static double median(std::vector<float> samples);
+    static double mann_whitney(const std::vector<float> & baseline, const std::vector<float> & current);
+
+    const char *path;
+    std::vector<baseline_entry_t> entries;
+
+    // relative slowdown in percent and significance level of a regression
+    double threshold, alpha;
+};
+
+#endif
@@ -18,66 +18,149 @@
 #include <iostream>
 #include <iomanip>
 #include <cstdlib>
+#include <stdexcept>
 #include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <sys/wait.h>
+#include <sys/resource.h>
 #include <time.h>
-#include <sys/time.h>
 
 #include "bm.h"
+#include "jobs.h"
+#include "cpu.h"
 
 using namespace std;
 
-static inline double bench_elapsed_s(const struct timespec* start, const struct timespec* end)
-{
-    return ((end->tv_sec - start->tv_sec)
-            + ((end->tv_nsec - start->tv_nsec) * 0.000000001));
-}
-
-static inline struct timespec bench_start()
-{
-    struct timespec start_t;
-    clock_gettime(CLOCK_REALTIME, &start_t);
-    return start_t;
-}
-
-static inline double bench_end(const struct timespec* start_t)
-{
-    struct timespec end_t;
-    clock_gettime(CLOCK_REALTIME, &end_t);
-    return bench_elapsed_s(start_t, &end_t);
-}
-
 Bench::Bench(const char* uri, uint32_t sample_rate, uint32_t frame_size, uint32_t n_frames,
-             const char *signal, const char *output)
+             const char *signal, const char *output, block_mode_t blocks, uint32_t seq_size)
 {
     this->sample_rate = sample_rate;
     this->frame_size = frame_size;
     this->n_frames = n_frames;
+    this->signal = signal;
+    this->timer = NULL;
+    this->full_test = false;
+    this->print_combinations = false;
+    this->zero_copy = false;
+    this->jobs = 1;
+    this->sweep = SWEEP_EXHAUSTIVE;
+    this->strength = 2;
+    this->covering = NULL;
+    this->n_combinations_tested = 0;
+    this->search_budget = 100;
+    this->search_time = 0.0;
+    this->warmup = 0;
+    this->warmup_auto = false;
+    this->warmup_cycles = 0;
+    this->cold_cycle = 0.0;
+    this->repeat = 1;
+    this->deadline = false;
+    this->ftz = FTZ_OFF;
+    this->midi_pattern = "chords";
+    this->voices = 4;
+    this->midi = NULL;
+    this->midi_output = NULL;
+    this->midi_writer = NULL;
+    this->polyphony = 0;
+    this->polyphony_base = this->polyphony_per_voice = this->max_voices = NAN;
+    this->perf_counters = false;
+    this->perf = NULL;
+    this->rt_check = false;
+    memset(&this->rt_report, 0, sizeof(this->rt_report));
+    this->rt_report.first = -1;
+    this->blocks = blocks;
+    this->block_position = 0;
+    this->blocks_jack_load = 0.0;
+    memset(&this->deadline_info, 0, sizeof(this->deadline_info));
+    this->rt_priority = 0;
+    this->cpu = -1;
+    this->worker_cpu = -1;
+    this->lock_memory = false;
+    this->prefault = false;
+    this->rseed = 1;
+
+    // the input signal is indexed by 32 bits offsets
+    uint64_t n_samples = (uint64_t) frame_size * n_frames;
+    if (n_samples > UINT32_MAX)
+        throw std::runtime_error("The input signal is too long, reduce the frame size or the number of frames");
 
     // create plugin instance
-    plugin = new Plugin(uri, sample_rate, frame_size);
+    // the plugin is told the run function might get any length up to the frame size
+    plugin = new Plugin(uri, sample_rate, frame_size, blocks == BLOCKS_FIXED ? frame_size : 1, seq_size);
+
+    // the other tests still run with the fixed length
+    if (blocks != BLOCKS_FIXED && plugin->fixed_block_length) {
+        cerr << "warning: the plugin requires a fixed block length, the block lengths test was not executed" << endl;
+        this->blocks = BLOCKS_FIXED;
+    }
+    else if (blocks != BLOCKS_FIXED && blocks != BLOCKS_POW2 && plugin->power_of_2_block_length) {
+        cerr << "warning: the plugin requires power of two block lengths, the block lengths test was not executed"
+             << endl;
+        this->blocks = BLOCKS_FIXED;
+    }
 
     // set default vars values
     n_points_default = 4;
-    smaller.jack_load = 100.0;
+    smaller.jack_load = HUGE_VAL;
     bigger.jack_load = 0.0;
 
     // create testing points for each parameter
     slice_parameters();
 
     // signal generator
-    double duration = (double) (frame_size * n_frames) / (double) sample_rate;
+    double duration = (double) n_samples / (double) sample_rate;
     generator = new Generator(sample_rate, signal, duration);
 
+    // the whole input signal is rendered before the benchmark, so the
+    // generator cost is not measured along with the plugin
+    input_signal = generator->render(n_samples, frame_size);
+    if (!input_signal) {
+        // the destructor doesn't run for a partly built object
+        delete plugin;
+        delete generator;
+        throw std::runtime_error("Can't allocate the input signal buffer");
+    }
+
+    // allocated once, the cycles loop doesn't allocate memory
+    cycles.resize(n_frames);
+
     // create sound file
-    int n_channels = plugin->audio->outputs_by_index.size();
-    if (output)
-        sndfile = SndfileHandle(output, SFM_WRITE, SF_FORMAT_FLAC | SF_FORMAT_PCM_24, n_channels, sample_rate);
+    writer = NULL;
+    uint32_t n_channels = plugin->audio->outputs_by_index.size();
+    if (output && n_channels > 0) {
+        writer = new AudioWriter(output, n_channels, sample_rate, frame_size);
+        if (!writer->is_open()) {
+            cerr << "warning: can't create the output file " << output << endl;
+            delete writer;
+            writer = NULL;
+        }
+
+        for (uint32_t i = 0; i < n_channels; i++) {
+            output_buffers.push_back(plugin->audio->outputs_by_index[i].buffer);
+        }
+    }
 }
 
 Bench::~Bench()
 {
     delete plugin;
     delete generator;
+
+    if (midi)
+        delete midi;
+
+    // the MIDI file is written when the writer is deleted
+    if (midi_writer)
+        delete midi_writer;
+    free(input_signal);
+
+    // waits the pending audio to be written
+    if (writer)
+        delete writer;
+
+    if (covering)
+        delete covering;
 }
 
 void Bench::slice_parameters(void)
@@ -99,115 +182,1061 @@ void Bench::slice_parameters(void)
     }
 }
 
-void Bench::test_points(uint32_t depth, vector<uint32_t> & params, vector<uint32_t> & n_points)
+uint64_t Bench::count_combinations(bool exhaustive)
+{
+    if (covering && !exhaustive)
+        return covering->rows.size();
+
+    if (n_points_to_test.empty())
+        return 0;
+
+    uint64_t count = 1;
+    for (uint32_t i = 0; i < n_points_to_test.size(); i++) {
+        if (n_points_to_test[i] == 0)
+            return 0;
+
+        // saturate, such amount of combinations can't be tested anyway
+        if (count > UINT64_MAX / n_points_to_test[i])
+            return UINT64_MAX;
+
+        count *= n_points_to_test[i];
+    }
+
+    return count;
+}
+
+void Bench::set_combination(uint64_t index)
 {
-    if (depth > 0) {
-        for (uint32_t i = 0; i < n_points[depth-1]; i++) {
-            params[depth-1] = i;
-            test_points(depth-1, params, n_points);
+    if (!search_points.empty()) {
+        // the combination index is the evaluation number of the search
+        for (uint32_t i = 0; i < params.size(); i++) {
+            plugin->control->inputs_by_index[i].value = search_points[index][i];
         }
+        return;
+    }
+
+    if (covering) {
+        // the combination index is a row of the covering array
+        params = covering->rows[index];
     }
     else {
+        // the combination index is a mixed radix number, one digit per control
         for (uint32_t i = 0; i < params.size(); i++) {
-            float range = plugin->control->inputs_by_index[i].max - plugin->control->inputs_by_index[i].min;
-            float step = range / (float)(n_points[i] - 1);
+            params[i] = index % n_points_to_test[i];
+            index /= n_points_to_test[i];
+        }
+    }
 
-            float value;
-            value = plugin->control->inputs_by_index[i].min;
-            value += (step * params[i]);
+    for (uint32_t i = 0; i < params.size(); i++) {
+        port_data_t *port = &plugin->control->inputs_by_index[i];
+        port->value = point_value(port, params[i], n_points_to_test[i]);
+    }
+}
 
-            // integer
-            if (plugin->control->inputs_by_index[i].is_integer) {
-                value = (int32_t) round(value);
-            }
+float Bench::point_value(port_data_t *port, uint32_t point, uint32_t n_points)
+{
+    // enumeration and scale point
+    if ((port->is_enumeration || port->is_scale_point) && point < port->scale_points.count)
+        return port->scale_points.values[point];
 
-            // enumeration and scale point
-            if (plugin->control->inputs_by_index[i].is_enumeration ||
-                plugin->control->inputs_by_index[i].is_scale_point) {
-                uint32_t index = params[i];
-                value = plugin->control->inputs_by_index[i].scale_points.values[index];
-            }
+    // toggle: off and on, trigger: no pulse and pulse
+    if (port->is_toggled || port->is_trigger)
+        return point ? 1.0 : 0.0;
 
-            // TODO: toggle and trigger
-            if (plugin->control->inputs_by_index[i].is_toggled ||
-                plugin->control->inputs_by_index[i].is_trigger) {
-            }
+    return port_value(port, n_points > 1 ? (double) point / (n_points - 1) : 0.0);
+}
 
-            // TODO: logarithmic
-            if (plugin->control->inputs_by_index[i].is_logarithmic) {
-            }
+void Bench::test_combinations(uint64_t first, uint64_t last, FILE *results)
+{
+    for (uint64_t index = first; index < last; index++) {
+        set_combination(index);
+
+        bench_info_t tmp;
+        run_and_calc(&tmp);
 
-            plugin->control->inputs_by_index[i].value = value;
+        combination_t result;
+        result.index = index;
+        result.total = tmp.total;
+        result.average = tmp.average;
+        result.jack_load = tmp.jack_load;
+        result.p50 = tmp.p50;
+        result.p90 = tmp.p90;
+        result.p99 = tmp.p99;
+        result.p999 = tmp.p999;
+        result.max = tmp.max;
+        result.stddev = tmp.stddev;
+        result.worst_cycle = tmp.worst_cycle;
 
-            bench_info_t tmp;
-            run_and_calc(&tmp);
+        // the results of shards are merged by the parent process
+        if (results)
+            fwrite(&result, sizeof(result), 1, results);
+        else
+            add_combination(&result);
+    }
+}
+
+void Bench::add_combination(combination_t *result)
+{
+    if (print_combinations)
+        combinations.push_back(*result);
 
-            if (tmp.jack_load < smaller.jack_load) smaller = tmp;
-            if (tmp.jack_load > bigger.jack_load) bigger = tmp;
+    if (result->jack_load < smaller.jack_load) set_result(&smaller, result);
+    if (result->jack_load > bigger.jack_load) set_result(&bigger, result);
+}
+
+void Bench::set_result(bench_info_t *var, combination_t *result)
+{
+    var->total = result->total;
+    var->average = result->average;
+    var->jack_load = result->jack_load;
+    var->p50 = result->p50;
+    var->p90 = result->p90;
+    var->p99 = result->p99;
+    var->p999 = result->p999;
+    var->max = result->max;
+    var->stddev = result->stddev;
+    var->worst_cycle = result->worst_cycle;
+    var->cycles.clear();
+    var->ipc = var->cache_misses = var->branch_misses = var->page_faults = var->context_switches = NAN;
+    var->events = var->event_bytes = var->full_cycles = 0;
+    var->events_per_second = 0.0;
+    var->load_median = var->load_ci_low = var->load_ci_high = result->jack_load;
+    var->trials = 1;
+    var->disturbed = 0;
+
+    // the controls values are recovered from the combination index
+    set_combination(result->index);
+    var->plugin_preset = plugin->control->inputs_by_index;
+}
+
+float Bench::port_value(port_data_t *port, double x)
+{
+    // maps a normalized position [0, 1] to a valid value of the port
+    if (x < 0.0) x = 0.0;
+    if (x > 1.0) x = 1.0;
+
+    if ((port->is_enumeration || port->is_scale_point) && port->scale_points.count > 0) {
+        uint32_t index = x * port->scale_points.count;
+        if (index >= port->scale_points.count) index = port->scale_points.count - 1;
+        return port->scale_points.values[index];
+    }
+
+    if (port->is_toggled || port->is_trigger)
+        return x < 0.5 ? 0.0 : 1.0;
+
+    float value;
+    if (port->is_logarithmic && port->min > 0.0 && port->max > port->min) {
+        // same ratio between consecutive points
+        value = port->min * pow(port->max / port->min, x);
+    }
+    else if (port->is_logarithmic && port->max < 0.0 && port->min < port->max) {
+        value = port->max * pow(port->min / port->max, 1.0 - x);
+    }
+    else if (port->is_logarithmic) {
+        // the range includes zero, use a 60dB logarithmic curve
+        value = port->min + (port->max - port->min) * (pow(1000.0, x) - 1.0) / 999.0;
+    }
+    else {
+        value = port->min + x * (port->max - port->min);
+    }
+
+    if (port->is_integer)
+        value = (int32_t) round(value);
+
+    return value;
+}
+
+uint32_t Bench::rand_int(void)
+{
+    // 31bit Park-Miller-Carta Pseudo-Random Number Generator
+    uint32_t hi, lo;
+    lo = 16807 * (rseed & 0xffff);
+    hi = 16807 * (rseed >> 16);
+
+    lo += (hi & 0x7fff) << 16;
+    lo += hi >> 15;
+    lo = (lo & 0x7fffffff) + (lo >> 31);
+    return (rseed = lo);
+}
+
+double Bench::rand_float(void)
+{
+    return rand_int() / 2147483648.0;
+}
+
+double Bench::evaluate(std::vector<double> & point)
+{
+    std::vector<float> values(point.size());
+    for (uint32_t i = 0; i < point.size(); i++) {
+        values[i] = port_value(&plugin->control->inputs_by_index[i], point[i]);
+    }
+
+    // the evaluations are kept so the results can be traced back to the controls values
+    uint64_t index = search_points.size();
+    search_points.push_back(values);
+    set_combination(index);
+
+    bench_info_t tmp;
+    run_and_calc(&tmp);
+
+    combination_t result;
+    result.index = index;
+    result.total = tmp.total;
+    result.average = tmp.average;
+    result.jack_load = tmp.jack_load;
+    result.p50 = tmp.p50;
+    result.p90 = tmp.p90;
+    result.p99 = tmp.p99;
+    result.p999 = tmp.p999;
+    result.max = tmp.max;
+    result.stddev = tmp.stddev;
+    result.worst_cycle = tmp.worst_cycle;
+    add_combination(&result);
+
+    return tmp.jack_load;
+}
+
+void Bench::search_worst_case(void)
+{
+    uint32_t n_params = params.size();
+    if (n_params == 0)
+        return;
+
+    // start from the default values
+    std::vector<double> current(n_params);
+    for (uint32_t i = 0; i < n_params; i++) {
+        port_data_t *port = &plugin->control->inputs_by_index[i];
+        float range = port->max - port->min;
+        current[i] = range > 0.0 ? (port->def - port->min) / range : 0.0;
+    }
+
+    double current_load = evaluate(current);
+    uint32_t evaluation = 1;
+
+    struct timespec start_t, now_t;
+    clock_gettime(CLOCK_MONOTONIC, &start_t);
+
+    // simulated annealing, each step changes a single control (coordinate move)
+    const double initial_temperature = 0.1;
+    while (search_budget == 0 || evaluation < search_budget) {
+        clock_gettime(CLOCK_MONOTONIC, &now_t);
+        double elapsed = (now_t.tv_sec - start_t.tv_sec) + (now_t.tv_nsec - start_t.tv_nsec) * 1e-9;
+        if (search_time > 0.0 && elapsed >= search_time)
+            break;
+
+        // the closest limit defines how far the search is
+        double progress = 0.0;
+        if (search_budget > 0) progress = (double) evaluation / search_budget;
+        if (search_time > 0.0 && elapsed / search_time > progress) progress = elapsed / search_time;
+        double temperature = initial_temperature * (1.0 - progress) + 1e-6;
+
+        uint32_t i = rand_int() % n_params;
+        port_data_t *port = &plugin->control->inputs_by_index[i];
+        std::vector<double> candidate = current;
+
+        if ((port->is_enumeration || port->is_scale_point) && port->scale_points.count > 0) {
+            // any other scale point
+            candidate[i] = (rand_int() % port->scale_points.count + 0.5) / port->scale_points.count;
+        }
+        else if (port->is_toggled || port->is_trigger) {
+            candidate[i] = current[i] < 0.5 ? 1.0 : 0.0;
+        }
+        else {
+            // gaussian step which shrinks as the temperature cools down
+            double u1 = rand_float() + 1e-12, u2 = rand_float();
+            double step = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+            candidate[i] += step * (0.05 + 0.5 * temperature / initial_temperature);
+
+            // reflect at the range limits
+            if (candidate[i] < 0.0) candidate[i] = -candidate[i];
+            if (candidate[i] > 1.0) candidate[i] = 2.0 - candidate[i];
+        }
+
+        double load = evaluate(candidate);
+        evaluation++;
+
+        // always accept higher loads, lower loads with a probability that decreases with time
+        double delta = (load - current_load) / (current_load > 0.0 ? current_load : 1.0);
+        if (delta >= 0.0 || rand_float() < exp(delta / temperature)) {
+            current = candidate;
+            current_load = load;
         }
     }
 }
 
-void Bench::run_and_calc(bench_info_t* var, bool save_output)
+// runs a slice of the full test combinations in its own process
+class ShardJob : public Job {
+public:
+    ShardJob(Bench *bench, const char *signal, uint64_t n_combinations, uint32_t n_shards)
+        : bench(bench), signal(signal), n_combinations(n_combinations), n_shards(n_shards) {}
+
+    int run(uint32_t task, FILE *data)
+    {
+        try {
+            // each shard uses its own plugin instance
+            Bench shard(bench->plugin->uri.c_str(), bench->sample_rate, bench->frame_size,
+                        bench->n_frames, signal, NULL, bench->blocks, bench->plugin->seq_size);
+            shard.timer = bench->timer;
+            shard.zero_copy = bench->zero_copy;
+            shard.warmup = bench->warmup;
+            shard.warmup_auto = bench->warmup_auto;
+
+            // the shard is pinned by the pool, the scheduling is inherited
+            // but the memory locks are not
+            shard.lock_memory = bench->lock_memory;
+            shard.prefault = bench->prefault;
+            shard.worker_cpu = bench->worker_cpu;
+            shard.setup_realtime();
+
+            // the detection is enabled by the parent, only the calls of the
+            // shard go back to it
+            shard.rt_check = bench->rt_check;
+            if (shard.rt_check)
+                rtcheck_reset();
+
+            shard.midi_pattern = bench->midi_pattern;
+            shard.voices = bench->voices;
+            shard.setup_midi();
+
+            // the covering array is inherited from the parent process
+            if (bench->covering)
+                shard.covering = new CoveringArray(*bench->covering);
+
+            if (shard.warmup > 0 || shard.warmup_auto)
+                shard.warm_up();
+
+            shard.test_combinations(first(task), first(task + 1), data);
+
+            // the report follows the results
+            if (shard.rt_check)
+                fwrite(rtcheck_get_report(), sizeof(rtcheck_report_t), 1, data);
+        }
+        catch(exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    void finish(uint32_t task, int status, FILE *data)
+    {
+        bool finished = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+        // with the RT-safety check, the data of a finished shard ends with its report
+        uint64_t n_results = UINT64_MAX;
+        if (bench->rt_check && finished) {
+            fseek(data, 0, SEEK_END);
+            n_results = (ftell(data) - sizeof(rtcheck_report_t)) / sizeof(combination_t);
+            rewind(data);
+        }
+
+        combination_t result;
+        for (uint64_t i = 0; i < n_results && fread(&result, sizeof(result), 1, data) == 1; i++) {
+            bench->add_combination(&result);
+        }
+
+        rtcheck_report_t report;
+        if (bench->rt_check && finished && fread(&report, sizeof(report), 1, data) == 1)
+            rtcheck_merge(&report);
+
+        if (!finished) {
+            cerr << "warning: full test shard " << task << " (combinations " << first(task)
+                 << " to " << first(task + 1) - 1 << ") did not finish" << endl;
+        }
+    }
+
+private:
+    uint64_t first(uint32_t task)
+    {
+        uint64_t per_shard = n_combinations / n_shards, remainder = n_combinations % n_shards;
+        return task * per_shard + (task < remainder ? task : remainder);
+    }
+
+    Bench *bench;
+    const char *signal;
+    uint64_t n_combinations;
+    uint32_t n_shards;
+};
+
+void Bench::test_shards(uint64_t n_combinations)
 {
-    struct timespec ts = bench_start();
+    JobPool pool(jobs);
 
-    for (uint32_t i = 0; i < n_frames; ++i) {
-        // get input frame
-        float *input_buffer = generator->get_frame(frame_size);
+    uint32_t n_shards = pool.n_jobs;
+    if (n_combinations < n_shards) n_shards = n_combinations;
+
+    ShardJob job(this, signal, n_combinations, n_shards);
+    pool.run(&job, n_shards);
+}
+
+double Bench::run_cycle(uint32_t cycle)
+{
+    // each cycle is timed alone so spikes are not hidden by the average
+    uint64_t start = timer->now();
+
+    // get input frame, the signal repeats when there are more cycles than frames
+    float *input_buffer = input_signal + (cycle % n_frames) * frame_size;
 
+    if (zero_copy) {
+        // connects the plugin inputs directly to the input signal
+        for (uint32_t i = 0; i < plugin->audio->inputs_by_index.size(); i++) {
+            plugin->instance->connect_port(plugin->audio->inputs_by_index[i].index, input_buffer);
+        }
+    }
+    else {
         // copies the input buffer to plugin inputs
         for (uint32_t i = 0; i < plugin->audio->inputs_by_index.size(); i++) {
             plugin->audio->inputs_by_index[i].write_buffer(input_buffer, frame_size);
         }
+    }
+
+    plugin->run(frame_size);
+
+    return timer->elapsed(start, timer->now());
+}
+
+void Bench::restore_inputs(void)
+{
+    // restore the inputs own buffers
+    if (zero_copy) {
+        for (uint32_t i = 0; i < plugin->audio->inputs_by_index.size(); i++) {
+            port_data_t *port = &plugin->audio->inputs_by_index[i];
+            plugin->instance->connect_port(port->index, port->buffer);
+        }
+    }
+}
 
-        plugin->run(frame_size);
+void Bench::setup_midi(void)
+{
+    if (midi || !midi_pattern || plugin->midi_inputs() == 0)
+        return;
+
+    // the sequence has the length of the input signal
+    midi = new MidiGenerator(sample_rate, midi_pattern, voices, (uint64_t) frame_size * n_frames);
+    plugin->midi_input = midi;
+}
+
+void Bench::setup_midi_output(void)
+{
+    if (midi_writer || !midi_output || plugin->atom->outputs_by_index.empty())
+        return;
+
+    midi_writer = new MidiWriter(midi_output, sample_rate);
+    if (!midi_writer->is_open()) {
+        cerr << "warning: can't create the MIDI file " << midi_output << endl;
+        delete midi_writer;
+        midi_writer = NULL;
+    }
+}
+
+void Bench::setup_realtime(void)
+{
+    if (lock_memory) {
+        int error = cpu_lock_memory();
+        if (error)
+            cerr << "warning: can't lock the memory (" << strerror(error) << ")" << endl;
+    }
 
-        // copies the outputs buffer to output file
-        if (save_output && sndfile) {
-            int n_ouputs = plugin->audio->outputs_by_index.size();
-            float interleaved[frame_size * n_ouputs];
+    if (prefault) {
+        cpu_prefault_stack();
 
-            for (uint32_t i = 0; i < frame_size; i++) {
-                for (int j = 0; j < n_ouputs; j++) {
-                    interleaved[i * n_ouputs + j] = plugin->audio->outputs_by_index[j].buffer[i];
-                }
+        // the pages of the audio buffers are only mapped when first written
+        for (uint32_t i = 0; i < plugin->audio->inputs_by_index.size(); i++) {
+            port_data_t *port = &plugin->audio->inputs_by_index[i];
+            memset(port->buffer, 0, port->buffer_size * sizeof(float));
+        }
+        for (uint32_t i = 0; i < plugin->audio->outputs_by_index.size(); i++) {
+            port_data_t *port = &plugin->audio->outputs_by_index[i];
+            memset(port->buffer, 0, port->buffer_size * sizeof(float));
+        }
+    }
+
+    if (cpu >= 0) {
+        affinity = cpu_allowed_list();
+        if (!cpu_pin_thread(pthread_self(), cpu))
+            cerr << "warning: can't pin the benchmark thread to CPU " << cpu << endl;
+    }
+
+    if (worker_cpu >= 0) {
+        if (!plugin->worker)
+            cerr << "warning: the plugin has no worker thread to pin" << endl;
+        else if (!cpu_pin_thread(plugin->worker->thread(), worker_cpu))
+            cerr << "warning: can't pin the worker thread to CPU " << worker_cpu << endl;
+    }
+
+    if (rt_priority > 0) {
+        int error = cpu_set_realtime(pthread_self(), rt_priority);
+        if (error) {
+            cerr << "warning: can't set SCHED_FIFO priority " << rt_priority << " ("
+                 << strerror(error) << ")" << endl;
+        }
+    }
+}
+
+void Bench::restore_realtime(void)
+{
+    // the results are printed with normal scheduling
+    if (rt_priority > 0)
+        cpu_set_realtime(pthread_self(), 0);
+
+    // the threads of the next benchmark (output writer, plugin worker) would
+    // inherit the pinning and share the CPU with the timed loop
+    if (!affinity.empty())
+        cpu_set_affinity(pthread_self(), affinity);
+}
+
+void Bench::warm_up(void)
+{
+    // the warm-up runs with the default controls values, the first cycle gets
+    // the cold caches, lazy allocations and page faults of the plugin buffers
+    plugin->control->set_value(DEFAULT_PRESET_LABEL);
+
+    std::vector<double> times;
+    std::vector<double> window(WARMUP_WINDOW);
+    double previous = 0.0;
+
+    uint32_t limit = warmup;
+    if (warmup_auto)
+        limit = WARMUP_AUTO_LIMIT * sample_rate / frame_size;
+
+    for (warmup_cycles = 0; warmup_cycles < limit; warmup_cycles++) {
+        double elapsed = run_cycle(warmup_cycles);
+        if (warmup_cycles == 0)
+            cold_cycle = elapsed;
+
+        if (!warmup_auto)
+            continue;
+
+        // steady state: the median of the last window of cycles is close to
+        // the median of the window before
+        times.push_back(elapsed);
+        if (times.size() % WARMUP_WINDOW != 0)
+            continue;
+
+        std::copy(times.end() - WARMUP_WINDOW, times.end(), window.begin());
+        std::nth_element(window.begin(), window.begin() + WARMUP_WINDOW / 2, window.end());
+        double median = window[WARMUP_WINDOW / 2];
+
+        if (times.size() > WARMUP_WINDOW && fabs(median - previous) <= WARMUP_TOLERANCE * previous) {
+            warmup_cycles++;
+            break;
+        }
+
+        previous = median;
+    }
+
+    if (warmup_auto && warmup_cycles == limit)
+        cerr << "warning: no steady state after " << limit << " warm-up cycles" << endl;
+
+    restore_inputs();
+}
+
+static inline uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void deadline_stats(double *stats, Histogram *histogram)
+{
+    // all periods had xruns, there is no slack
+    if (histogram->count == 0) {
+        for (uint32_t i = 0; i < 5; i++) stats[i] = 0.0;
+        return;
+    }
+
+    stats[0] = histogram->min;
+    stats[1] = histogram->percentile(1.0);
+    stats[2] = histogram->percentile(50.0);
+    stats[3] = histogram->percentile(99.0);
+    stats[4] = histogram->max;
+}
+
+void Bench::run_deadline(deadline_info_t *info)
+{
+    // each period starts at an absolute deadline, like the JACK process
+    // thread woken by the audio interface, and the plugin must finish before
+    // the next period starts
+    uint64_t period = (uint64_t) frame_size * 1000000000ULL / sample_rate;
+    Histogram jitter, slack;
+    uint32_t xruns = 0;
+
+    plugin->control->set_value(DEFAULT_PRESET_LABEL);
+
+    if (plugin->midi_input)
+        plugin->midi_input->rewind();
+
+    // starts on the next period, so the first wake up is also a sleep
+    uint64_t wake = monotonic_ns() + period;
+
+    for (uint32_t i = 0; i < n_frames; i++) {
+        struct timespec ts;
+        ts.tv_sec = wake / 1000000000ULL;
+        ts.tv_nsec = wake % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+
+        uint64_t start = monotonic_ns();
+        run_cycle(i);
+        uint64_t end = monotonic_ns();
+
+        jitter.add((start - wake) / 1e9);
+
+        uint64_t next = wake + period;
+        if (end <= next) {
+            slack.add((next - end) / 1e9);
+        }
+        else {
+            // the periods which passed while the plugin was running are lost,
+            // the next cycle waits for the next period boundary
+            uint64_t missed = (end - next) / period + 1;
+            xruns += missed;
+            next += missed * period;
+        }
+
+        wake = next;
+    }
+
+    restore_inputs();
+
+    info->periods = n_frames;
+    info->xruns = xruns;
+    info->period = period / 1e9;
+    deadline_stats(info->jitter, &jitter);
+    deadline_stats(info->slack, &slack);
+}
+
+uint32_t Bench::next_block_length(uint32_t cycle, uint32_t remaining)
+{
+    uint32_t length = remaining;
+
+    if (blocks == BLOCKS_RANDOM) {
+        length = 1 + rand_int() % remaining;
+    }
+    else if (blocks == BLOCKS_POW2) {
+        // each cycle halves the length, from the frame size down to 1
+        uint32_t n_lengths = 1;
+        while ((frame_size >> n_lengths) > 0) n_lengths++;
+        length = frame_size >> (cycle % n_lengths);
+    }
+    else if (blocks == BLOCKS_PATTERN && !block_pattern.empty()) {
+        // the pattern continues in the next cycle, as the events of a host
+        length = block_pattern[block_position++ % block_pattern.size()];
+    }
+
+    return length < remaining ? length : remaining;
+}
+
+void Bench::connect_audio(uint32_t offset)
+{
+    for (uint32_t i = 0; i < plugin->audio->inputs_by_index.size(); i++) {
+        port_data_t *port = &plugin->audio->inputs_by_index[i];
+        plugin->instance->connect_port(port->index, port->buffer + offset);
+    }
+    for (uint32_t i = 0; i < plugin->audio->outputs_by_index.size(); i++) {
+        port_data_t *port = &plugin->audio->outputs_by_index[i];
+        plugin->instance->connect_port(port->index, port->buffer + offset);
+    }
+}
+
+void Bench::run_blocks(void)
+{
+    // the cycles are split in several calls, like a host which splits the
+    // cycles on automation or MIDI events, and each call is timed
+    plugin->control->set_value(DEFAULT_PRESET_LABEL);
+
+    // one bucket per power of two of the block length
+    block_stats.clear();
+    for (uint32_t length = 1; length <= frame_size; length *= 2) {
+        block_stats_t stats;
+        stats.min_length = length;
+        stats.max_length = length * 2 - 1 < frame_size ? length * 2 - 1 : frame_size;
+        stats.calls = stats.samples = 0;
+        stats.time = 0.0;
+        block_stats.push_back(stats);
+    }
+
+    block_position = 0;
+    double total = 0.0;
+
+    if (plugin->midi_input)
+        plugin->midi_input->rewind();
+
+    for (uint32_t i = 0; i < n_frames; i++) {
+        float *input_buffer = input_signal + i * frame_size;
+        for (uint32_t j = 0; j < plugin->audio->inputs_by_index.size(); j++) {
+            plugin->audio->inputs_by_index[j].write_buffer(input_buffer, frame_size);
+        }
+
+        uint32_t offset = 0;
+        while (offset < frame_size) {
+            uint32_t length = next_block_length(i, frame_size - offset);
+            connect_audio(offset);
+
+            uint64_t start = timer->now();
+            plugin->run(length);
+            double elapsed = timer->elapsed(start, timer->now());
+
+            uint32_t bucket = 0;
+            while ((2u << bucket) <= length) bucket++;
+
+            block_stats[bucket].calls++;
+            block_stats[bucket].samples += length;
+            block_stats[bucket].time += elapsed;
+            total += elapsed;
+
+            offset += length;
+        }
+    }
+
+    connect_audio(0);
+
+    blocks_jack_load = load(total / n_frames);
+}
+
+void Bench::run_polyphony(void)
+{
+    // held chords of 1, 2, 4 ... voices, each one during a whole test
+    plugin->control->set_value(DEFAULT_PRESET_LABEL);
+
+    std::vector<uint32_t> ramp;
+    for (uint32_t voices = 1; voices < polyphony; voices *= 2) {
+        ramp.push_back(voices);
+    }
+    ramp.push_back(polyphony);
+
+    uint32_t settle_cycles = POLYPHONY_SETTLE * sample_rate / frame_size;
+    if (settle_cycles < 1) settle_cycles = 1;
+
+    polyphony_points.clear();
+    double n = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    MidiGenerator *held = NULL;
+    for (uint32_t i = 0; i <= ramp.size(); i++) {
+        // the notes of the previous test or step are released and their tails
+        // fade out before the step (and before the tests after the last one)
+        if (plugin->midi_input) {
+            plugin->midi_input->release();
+            for (uint32_t j = 0; j < settle_cycles; j++) {
+                run_cycle(j);
             }
-            sndfile.write(interleaved, frame_size * n_ouputs);
         }
+
+        delete held;
+        held = NULL;
+        if (i == ramp.size())
+            break;
+
+        held = new MidiGenerator(sample_rate, "held", ramp[i], (uint64_t) frame_size * n_frames);
+        plugin->midi_input = held;
+
+        bench_info_t result;
+        run_and_calc(&result);
+
+        if (held->dropped > 0)
+            cerr << "warning: " << held->dropped << " MIDI events didn't fit in the input buffers (see --seq-size)" << endl;
+
+        polyphony_point_t point;
+        point.voices = ramp[i];
+        point.average = result.average;
+        point.jack_load = result.jack_load;
+        polyphony_points.push_back(point);
+
+        n += 1.0;
+        sx += point.voices;
+        sy += point.jack_load;
+        sxx += (double) point.voices * point.voices;
+        sxy += point.voices * point.jack_load;
     }
 
-    double total = bench_end(&ts);
+    // the MIDI input of the other tests
+    plugin->midi_input = midi;
+
+    // least squares line, the maximum is where it reaches 100% of the JACK load
+    double det = n * sxx - sx * sx;
+    if (det <= 0.0)
+        return;
+
+    polyphony_per_voice = (n * sxy - sx * sy) / det;
+    polyphony_base = (sy - polyphony_per_voice * sx) / n;
+    max_voices = polyphony_per_voice > 0.0 ? (100.0 - polyphony_base) / polyphony_per_voice : INFINITY;
+}
+
+void Bench::run_and_calc(bench_info_t* var, bool save_output)
+{
+    double total = 0.0, worst = 0.0;
+    uint32_t worst_cycle = 0;
+
+    histogram.reset();
+
+    // the MIDI input starts over along with the input signal
+    if (plugin->midi_input)
+        plugin->midi_input->rewind();
+
+    if (var)
+        var->plugin_preset = plugin->control->inputs_by_index;
+
+    // the triggers are pulsed, they keep the value during the first cycle only
+    std::vector<port_data_t*> triggers;
+    for (uint32_t i = 0; i < plugin->control->inputs_by_index.size(); i++) {
+        port_data_t *port = &plugin->control->inputs_by_index[i];
+        if (port->is_trigger && port->value != port->def) triggers.push_back(port);
+    }
+
+    // involuntary context switches mean the plugin was preempted during the test
+    struct rusage usage_start, usage_end;
+    getrusage(RUSAGE_THREAD, &usage_start);
+
+    if (perf)
+        perf->reset();
+
+    event_stats_t events_start = plugin->output_events;
+    MidiWriter *midi_file = save_output ? midi_writer : NULL;
+
+    for (uint32_t i = 0; i < n_frames; ++i) {
+        // the counters only run around the timed region
+        if (perf) perf->enable();
+        double elapsed = run_cycle(i);
+        if (perf) perf->disable();
+
+        plugin->read_events((uint64_t) i * frame_size, midi_file);
+
+        // queues the outputs to the file writer thread
+        if (save_output && writer)
+            writer->write(&output_buffers[0]);
+
+        total += elapsed;
+        cycles[i] = elapsed;
+        histogram.add(elapsed);
+
+        if (elapsed > worst) {
+            worst = elapsed;
+            worst_cycle = i;
+        }
+
+        // reset the triggers after the pulse
+        if (i == 0) {
+            for (uint32_t j = 0; j < triggers.size(); j++) {
+                triggers[j]->value = triggers[j]->def;
+            }
+        }
+    }
+
+    getrusage(RUSAGE_THREAD, &usage_end);
+
+    restore_inputs();
 
     if (var) {
         var->total = total;
         var->average = (var->total / (double)n_frames);
-        double jack_latency = (double) frame_size / sample_rate;
-        var->jack_load = 2.0 * (var->average * 100.0) / jack_latency;
+        var->jack_load = load(var->average);
+
+        var->p50 = histogram.percentile(50.0);
+        var->p90 = histogram.percentile(90.0);
+        var->p99 = histogram.percentile(99.0);
+        var->p999 = histogram.percentile(99.9);
+        var->max = histogram.max;
+        var->stddev = histogram.stddev();
+        var->worst_cycle = worst_cycle;
+        var->cycles = cycles;
+
+        var->load_median = var->load_ci_low = var->load_ci_high = var->jack_load;
+        var->trials = 1;
+        var->disturbed = usage_end.ru_nivcsw > usage_start.ru_nivcsw ? 1 : 0;
+
+        var->events = plugin->output_events.events - events_start.events;
+        var->event_bytes = plugin->output_events.bytes - events_start.bytes;
+        var->full_cycles = plugin->output_events.full - events_start.full;
+        var->events_per_second = var->events * (double) sample_rate / ((double) n_frames * frame_size);
+
+        var->ipc = var->cache_misses = var->branch_misses = var->page_faults = var->context_switches = NAN;
+        if (perf) {
+            perf->read_values();
+
+            double samples = (double) n_frames * frame_size;
+            if (perf->available(PERF_CYCLES) && perf->available(PERF_INSTRUCTIONS) && perf->values[PERF_CYCLES])
+                var->ipc = (double) perf->values[PERF_INSTRUCTIONS] / perf->values[PERF_CYCLES];
+            if (perf->available(PERF_CACHE_MISSES))
+                var->cache_misses = perf->values[PERF_CACHE_MISSES] / samples;
+            if (perf->available(PERF_BRANCH_MISSES))
+                var->branch_misses = perf->values[PERF_BRANCH_MISSES] / samples;
+            if (perf->available(PERF_PAGE_FAULTS))
+                var->page_faults = (double) perf->values[PERF_PAGE_FAULTS] / n_frames;
+            if (perf->available(PERF_CONTEXT_SWITCHES))
+                var->context_switches = (double) perf->values[PERF_CONTEXT_SWITCHES] / n_frames;
+        }
     }
 }
 
+void Bench::merge_trials(bench_info_t *var, std::vector<bench_info_t> & trials)
+{
+    // the disturbed trials are rejected, unless all of them are disturbed
+    std::vector<double> loads;
+    std::vector<uint32_t> valid;
+    uint32_t disturbed = 0;
+    for (uint32_t i = 0; i < trials.size(); i++) {
+        disturbed += trials[i].disturbed;
+        if (!trials[i].disturbed) valid.push_back(i);
+    }
+
+    if (valid.empty()) {
+        cerr << "warning: all the trials were preempted, none was rejected" << endl;
+        for (uint32_t i = 0; i < trials.size(); i++) valid.push_back(i);
+    }
+
+    for (uint32_t i = 0; i < valid.size(); i++) {
+        loads.push_back(trials[valid[i]].jack_load);
+    }
+
+    // the reported result is the trial of the median load
+    std::vector<double> sorted = loads;
+    std::sort(sorted.begin(), sorted.end());
+    double median = sorted[sorted.size() / 2];
+    if (sorted.size() % 2 == 0)
+        median = (median + sorted[sorted.size() / 2 - 1]) / 2.0;
+
+    uint32_t chosen = valid[0];
+    for (uint32_t i = 0; i < valid.size(); i++) {
+        if (fabs(loads[i] - median) < fabs(trials[chosen].jack_load - median)) chosen = valid[i];
+    }
+
+    *var = trials[chosen];
+    var->load_median = median;
+    var->trials = trials.size();
+    var->disturbed = disturbed;
+
+    // percentile bootstrap of the median
+    std::vector<double> medians(BOOTSTRAP_RESAMPLES);
+    std::vector<double> resample(loads.size());
+    for (uint32_t b = 0; b < BOOTSTRAP_RESAMPLES; b++) {
+        for (uint32_t i = 0; i < loads.size(); i++) {
+            resample[i] = loads[rand_int() % loads.size()];
+        }
+
+        std::sort(resample.begin(), resample.end());
+        medians[b] = resample[resample.size() / 2];
+        if (resample.size() % 2 == 0)
+            medians[b] = (medians[b] + resample[resample.size() / 2 - 1]) / 2.0;
+    }
+
+    std::sort(medians.begin(), medians.end());
+    var->load_ci_low = medians[(uint32_t) (0.025 * (BOOTSTRAP_RESAMPLES - 1))];
+    var->load_ci_high = medians[(uint32_t) (0.975 * (BOOTSTRAP_RESAMPLES - 1))];
+}
+
+double Bench::load(double cycle_time)
+{
+    double jack_latency = (double) frame_size / sample_rate;
+    return 2.0 * (cycle_time * 100.0) / jack_latency;
+}
+
 void Bench::process(void)
 {
-    // process the benchmark using the minimum controls values
-    plugin->control->set_value(MINIMUM_PRESET_LABEL);
-    run_and_calc(&min);
+    setup_realtime();
+    setup_midi();
+    setup_midi_output();
 
-    // process the benchmark using the maximum controls values
-    plugin->control->set_value(MAXIMUM_PRESET_LABEL);
-    run_and_calc(&max);
+    // the denormals mode belongs to the thread, it is restored at the end
+    bool flushing = cpu_flushing_denormals();
+    if (!cpu_flush_denormals(ftz == FTZ_ON) && ftz != FTZ_OFF) {
+        cerr << "warning: can't flush the denormals to zero on this architecture" << endl;
+        ftz = FTZ_OFF;
+    }
 
-    // process the benchmark using the default controls values
-    plugin->control->set_value(DEFAULT_PRESET_LABEL);
-    run_and_calc(&def);
+    if (perf_counters) {
+        perf = new PerfCounters();
+        if (!perf->any_available()) {
+            cerr << "warning: can't open the performance counters, check "
+                    "/proc/sys/kernel/perf_event_paranoid" << endl;
+        }
+        else if (!perf->available(PERF_CYCLES)) {
+            cerr << "warning: hardware performance counters not available, only the software ones are used" << endl;
+        }
+    }
 
-    // generate the output audio file using the default control values
-    if (sndfile) {
-        run_and_calc(0, true);
+    if (rt_check)
+        rtcheck_enable(true);
+
+    if (warmup > 0 || warmup_auto)
+        warm_up();
+
+    // the trials of the min, max and def tests are interleaved, so a slow
+    // period of the host doesn't affect only one of them
+    const char *presets[] = {MINIMUM_PRESET_LABEL, MAXIMUM_PRESET_LABEL, DEFAULT_PRESET_LABEL};
+    bench_info_t *vars[] = {&min, &max, &def};
+    std::vector<bench_info_t> trials[3];
+
+    for (uint32_t trial = 0; trial < repeat; trial++) {
+        for (uint32_t i = 0; i < 3; i++) {
+            plugin->control->set_value(presets[i]);
+
+            // the outputs of the first trial of the default values are recorded to the audio file
+            bench_info_t result;
+            run_and_calc(&result, vars[i] == &def && trial == 0);
+            trials[i].push_back(result);
+        }
     }
 
+    // without warm-up the first min test takes the cold start
+    if (warmup == 0 && !warmup_auto)
+        cold_cycle = trials[0][0].cycles[0];
+
+    for (uint32_t i = 0; i < 3; i++) {
+        if (repeat > 1) merge_trials(vars[i], trials[i]);
+        else *vars[i] = trials[i][0];
+    }
+
+    // same tests flushing the denormals, a plugin much slower without
+    // flushing relies on the host to do it
+    if (ftz == FTZ_BOTH && cpu_flush_denormals(true)) {
+        bench_info_t *ftz_vars[] = {&min_ftz, &max_ftz, &def_ftz};
+        for (uint32_t i = 0; i < 3; i++) {
+            plugin->control->set_value(presets[i]);
+            run_and_calc(ftz_vars[i]);
+        }
+        cpu_flush_denormals(false);
+    }
+
+    // real time periods and split cycles, both with the default values
+    if (deadline)
+        run_deadline(&deadline_info);
+
+    if (blocks != BLOCKS_FIXED)
+        run_blocks();
+
+    if (polyphony > 0) {
+        if (plugin->midi_inputs() > 0)
+            run_polyphony();
+        else
+            cerr << "warning: the plugin has no MIDI inputs, the polyphony test was not executed" << endl;
+    }
+
+    if (midi && midi->dropped > 0)
+        cerr << "warning: " << midi->dropped << " MIDI events didn't fit in the input buffers (see --seq-size)" << endl;
+
+    if (min.full_cycles + def.full_cycles + max.full_cycles > 0)
+        cerr << "warning: the output event buffers got full, the plugin might have dropped events (see --seq-size)" << endl;
+
+    if (writer && writer->stalls > 0)
+        cerr << "warning: the output file writer fell behind on " << writer->stalls << " blocks" << endl;
+
     if (full_test) {
-        test_points(params.size(), params, n_points_to_test);
+        if (sweep == SWEEP_SEARCH) {
+            search_worst_case();
+            n_combinations_tested = search_points.size();
+        }
+        else {
+            if (sweep == SWEEP_COVERING && !params.empty())
+                covering = new CoveringArray(n_points_to_test, strength);
+
+            uint64_t n_combinations = count_combinations();
+            n_combinations_tested = n_combinations;
+
+            if (jobs > 1 && n_combinations > 1)
+                test_shards(n_combinations);
+            else
+                test_combinations(0, n_combinations);
+        }
 
         if (min.jack_load > bigger.jack_load) bigger = min;
         if (max.jack_load > bigger.jack_load) bigger = max;
@@ -217,18 +1246,287 @@ void Bench::process(void)
         if (max.jack_load < smaller.jack_load) smaller = max;
         if (def.jack_load < smaller.jack_load) smaller = def;
     }
+
+    if (perf) {
+        delete perf;
+        perf = NULL;
+    }
+
+    if (rt_check) {
+        rt_report = *rtcheck_get_report();
+        rtcheck_enable(false);
+    }
+
+    cpu_flush_denormals(flushing);
+    restore_realtime();
 }
 
-void Bench::print(void)
+void Bench::print(FILE *stream)
 {
-    printf("Plugin: %s, Input signal: %s\n", plugin->uri.c_str(), generator->signal_name);
-    printf("%12s%14s%13s%13s\n", "TestName", "TotalTime(s)", "AvrTime(s)", "JackLoad(%)");
-    printf("%12s%14.8f%13.8f%13f\n", "MinValues", min.total, min.average, min.jack_load);
-    printf("%12s%14.8f%13.8f%13f\n", "DefValues", def.total, def.average, def.jack_load);
-    printf("%12s%14.8f%13.8f%13f\n", "MaxValues", max.total, max.average, max.jack_load);
+    fprintf(stream, "Plugin: %s, Input signal: %s%s%s\n", plugin->uri.c_str(), generator->signal_name,
+            zero_copy ? " (zero-copy)" : "", ftz == FTZ_ON ? " (FTZ/DAZ)" : "");
+    if (midi) {
+        fprintf(stream, "MIDI input: %s, Voices: %u, Events: %llu\n", midi->pattern_name, midi->voices,
+                (unsigned long long) midi->count());
+    }
+    fprintf(stream, "Clock: %s, Resolution: %.1fns, Overhead: %.1fns\n", timer->source_name,
+            timer->resolution * 1e9, timer->overhead * 1e9);
+    fprintf(stream, "Warm-up: %u cycles%s, Cold cycle: %.8fs (%f%% JACK load)\n", warmup_cycles,
+            warmup_auto ? " (auto)" : "", cold_cycle, load(cold_cycle));
+    fprintf(stream, "%12s%14s%13s%13s\n", "TestName", "TotalTime(s)", "AvrTime(s)", "JackLoad(%)");
+    fprintf(stream, "%12s%14.8f%13.8f%13f\n", "MinValues", min.total, min.average, min.jack_load);
+    fprintf(stream, "%12s%14.8f%13.8f%13f\n", "DefValues", def.total, def.average, def.jack_load);
+    fprintf(stream, "%12s%14.8f%13.8f%13f\n", "MaxValues", max.total, max.average, max.jack_load);
 
     if (full_test) {
-        printf("%12s%14.8f%13.8f%13f\n", "BestResult", smaller.total, smaller.average, smaller.jack_load);
-        printf("%12s%14.8f%13.8f%13f\n", "WorstResult", bigger.total, bigger.average, bigger.jack_load);
+        fprintf(stream, "%12s%14.8f%13.8f%13f\n", "BestResult", smaller.total, smaller.average, smaller.jack_load);
+        fprintf(stream, "%12s%14.8f%13.8f%13f\n", "WorstResult", bigger.total, bigger.average, bigger.jack_load);
+    }
+
+    // per cycle load distribution
+    fprintf(stream, "%12s%11s%11s%11s%11s%11s%13s%12s\n", "TestName", "P50(%)", "P90(%)", "P99(%)",
+            "P99.9(%)", "Max(%)", "StdDev(s)", "WorstCycle");
+    print_cycles(stream, "MinValues", &min);
+    print_cycles(stream, "DefValues", &def);
+    print_cycles(stream, "MaxValues", &max);
+
+    if (full_test) {
+        print_cycles(stream, "BestResult", &smaller);
+        print_cycles(stream, "WorstResult", &bigger);
+    }
+
+    if (repeat > 1) {
+        fprintf(stream, "%12s%13s%13s%13s%9s%11s\n", "TestName", "Median(%)", "CI95Low(%)",
+                "CI95High(%)", "Trials", "Disturbed");
+        print_trials(stream, "MinValues", &min);
+        print_trials(stream, "DefValues", &def);
+        print_trials(stream, "MaxValues", &max);
+    }
+
+    if (perf_counters) {
+        fprintf(stream, "%12s%9s%15s%16s%14s%13s\n", "TestName", "IPC", "CacheMiss/Smp", "BranchMiss/Smp",
+                "Faults/Cycle", "CtxSw/Cycle");
+        print_counters(stream, "MinValues", &min);
+        print_counters(stream, "DefValues", &def);
+        print_counters(stream, "MaxValues", &max);
+    }
+
+    if (!plugin->atom->outputs_by_index.empty()) {
+        fprintf(stream, "%12s%11s%13s%13s%12s\n", "TestName", "Events", "Events/s", "Bytes", "FullCycles");
+        print_events(stream, "MinValues", &min);
+        print_events(stream, "DefValues", &def);
+        print_events(stream, "MaxValues", &max);
+    }
+
+    if (!plugin->atom->inputs_by_index.empty() || !plugin->atom->outputs_by_index.empty())
+        print_event_ports(stream);
+
+    if (ftz == FTZ_BOTH)
+        print_ftz(stream);
+
+    if (rt_check)
+        print_rt_check(stream);
+
+    if (deadline)
+        print_deadline(stream);
+
+    if (blocks != BLOCKS_FIXED)
+        print_blocks(stream);
+
+    if (!polyphony_points.empty())
+        print_polyphony(stream);
+
+    if (full_test) {
+        uint64_t n_exhaustive = count_combinations(true);
+        fprintf(stream, "Combinations tested: %llu of %s%llu", (unsigned long long) n_combinations_tested,
+                n_exhaustive == UINT64_MAX ? "more than " : "", (unsigned long long) n_exhaustive);
+
+        if (covering)
+            fprintf(stream, " (%u-wise covering array)", strength);
+        if (sweep == SWEEP_SEARCH)
+            fprintf(stream, " (adaptive search)");
+        fprintf(stream, "\n");
+
+        // controls values of the worst result
+        fprintf(stream, "%12s", "WorstValues");
+        std::map<uint32_t,port_data_t>::iterator it;
+        for (it = bigger.plugin_preset.begin(); it != bigger.plugin_preset.end(); ++it) {
+            fprintf(stream, " %s=%g", it->second.symbol, it->second.value);
+        }
+        fprintf(stream, "\n");
+    }
+
+    if (full_test && print_combinations)
+        print_combinations_table(stream);
+}
+
+void Bench::print_cycles(FILE *stream, const char *test_name, bench_info_t *var)
+{
+    fprintf(stream, "%12s%11f%11f%11f%11f%11f%13.8f%12u\n", test_name, load(var->p50), load(var->p90),
+            load(var->p99), load(var->p999), load(var->max), var->stddev, var->worst_cycle);
+}
+
+void Bench::print_trials(FILE *stream, const char *test_name, bench_info_t *var)
+{
+    fprintf(stream, "%12s%13f%13f%13f%9u%11u\n", test_name, var->load_median, var->load_ci_low,
+            var->load_ci_high, var->trials, var->disturbed);
+}
+
+void Bench::print_deadline(FILE *stream)
+{
+    fprintf(stream, "Deadline: %u periods of %.3fms, Xruns: %u\n", deadline_info.periods,
+            deadline_info.period * 1e3, deadline_info.xruns);
+    fprintf(stream, "%12s%11s%11s%11s%11s%11s\n", "", "Min(us)", "P1(us)", "P50(us)", "P99(us)", "Max(us)");
+
+    const char *names[] = {"WakeJitter", "Slack"};
+    double *stats[] = {deadline_info.jitter, deadline_info.slack};
+    for (uint32_t i = 0; i < 2; i++) {
+        fprintf(stream, "%12s%11.1f%11.1f%11.1f%11.1f%11.1f\n", names[i], stats[i][0] * 1e6,
+                stats[i][1] * 1e6, stats[i][2] * 1e6, stats[i][3] * 1e6, stats[i][4] * 1e6);
+    }
+}
+
+void Bench::print_blocks(FILE *stream)
+{
+    const char *modes[] = {"fixed", "random", "pow2", "pattern"};
+    fprintf(stream, "Block lengths: %s, JackLoad: %f%% (fixed: %f%%)\n", modes[blocks], blocks_jack_load,
+            def.jack_load);
+    fprintf(stream, "%12s%11s%13s%15s\n", "BlockLength", "Calls", "AvrCall(us)", "PerSample(ns)");
+
+    for (uint32_t i = 0; i < block_stats.size(); i++) {
+        block_stats_t *stats = &block_stats[i];
+        if (stats->calls == 0)
+            continue;
+
+        char range[32];
+        if (stats->min_length == stats->max_length)
+            snprintf(range, sizeof(range), "%u", stats->min_length);
+        else
+            snprintf(range, sizeof(range), "%u-%u", stats->min_length, stats->max_length);
+
+        fprintf(stream, "%12s%11llu%13.3f%15.3f\n", range, (unsigned long long) stats->calls,
+                stats->time / stats->calls * 1e6, stats->time / stats->samples * 1e9);
+    }
+}
+
+void Bench::print_polyphony(FILE *stream)
+{
+    fprintf(stream, "Polyphony: %f%% base, %f%% per voice, Max voices: %.1f\n", polyphony_base,
+            polyphony_per_voice, max_voices);
+    fprintf(stream, "%12s%13s%13s\n", "Voices", "AvrTime(s)", "JackLoad(%)");
+
+    for (uint32_t i = 0; i < polyphony_points.size(); i++) {
+        polyphony_point_t *point = &polyphony_points[i];
+        fprintf(stream, "%12u%13.8f%13f\n", point->voices, point->average, point->jack_load);
     }
 }
+
+void Bench::print_events(FILE *stream, const char *test_name, bench_info_t *var)
+{
+    fprintf(stream, "%12s%11llu%13.1f%13llu%12llu\n", test_name, (unsigned long long) var->events,
+            var->events_per_second, (unsigned long long) var->event_bytes, (unsigned long long) var->full_cycles);
+}
+
+void Bench::print_event_ports(FILE *stream)
+{
+    fprintf(stream, "%12s%11s%10s%14s\n", "EventPort", "Direction", "Size(B)", "HighWater(B)");
+
+    std::map<uint32_t,port_data_t> *groups[] = {&plugin->atom->inputs_by_index, &plugin->atom->outputs_by_index};
+    for (uint32_t g = 0; g < 2; g++) {
+        for (uint32_t i = 0; i < groups[g]->size(); i++) {
+            port_data_t *port = &(*groups[g])[i];
+            fprintf(stream, "%12s%11s%10u%14u\n", port->symbol, g == 0 ? "input" : "output",
+                    port->event_buffer_size, port->event_high_water);
+        }
+    }
+}
+
+void Bench::print_counters(FILE *stream, const char *test_name, bench_info_t *var)
+{
+    // the counters not available are printed as nan
+    fprintf(stream, "%12s%9.3f%15.5f%16.5f%14.4f%13.4f\n", test_name, var->ipc, var->cache_misses,
+            var->branch_misses, var->page_faults, var->context_switches);
+}
+
+void Bench::print_rt_check(FILE *stream)
+{
+    uint64_t violations = rtcheck_violations(&rt_report);
+    if (violations == 0) {
+        fprintf(stream, "RT-safety: no violations\n");
+        return;
+    }
+
+    fprintf(stream, "RT-safety: %llu violations, %llu bytes allocated\n", (unsigned long long) violations,
+            (unsigned long long) rt_report.bytes);
+    for (int i = 0; i < RTCHECK_CALLS; i++) {
+        if (rt_report.counts[i] > 0)
+            fprintf(stream, "%12s%12llu\n", rtcheck_call_name(i), (unsigned long long) rt_report.counts[i]);
+    }
+
+    fprintf(stream, "First offender (%s):\n", rtcheck_call_name(rt_report.first));
+    std::vector<std::string> frames = rtcheck_backtrace(&rt_report);
+    for (uint32_t i = 0; i < frames.size(); i++) {
+        fprintf(stream, "    %s\n", frames[i].c_str());
+    }
+}
+
+void Bench::print_ftz(FILE *stream)
+{
+    fprintf(stream, "%12s%13s%13s%9s\n", "TestName", "FtzOff(%)", "FtzOn(%)", "Ratio");
+
+    const char *names[] = {"MinValues", "DefValues", "MaxValues"};
+    bench_info_t *off[] = {&min, &def, &max};
+    bench_info_t *on[] = {&min_ftz, &def_ftz, &max_ftz};
+    for (uint32_t i = 0; i < 3; i++) {
+        fprintf(stream, "%12s%13f%13f%9.2f\n", names[i], off[i]->jack_load, on[i]->jack_load,
+                off[i]->jack_load / on[i]->jack_load);
+    }
+}
+
+void Bench::print_combinations_table(FILE *stream)
+{
+    fprintf(stream, "%20s%13s%11s", "Combination", "JackLoad(%)", "Max(%)");
+    for (uint32_t i = 0; i < params.size(); i++) {
+        fprintf(stream, "%14.13s", plugin->control->inputs_by_index[i].symbol);
+    }
+    fprintf(stream, "\n");
+
+    for (uint32_t i = 0; i < combinations.size(); i++) {
+        combination_t *result = &combinations[i];
+        fprintf(stream, "%20llu%13f%11f", (unsigned long long) result->index, result->jack_load, load(result->max));
+
+        set_combination(result->index);
+        for (uint32_t j = 0; j < params.size(); j++) {
+            fprintf(stream, "%14g", plugin->control->inputs_by_index[j].value);
+        }
+        fprintf(stream, "\n");
+    }
+}
+
+void Bench::save_preset(const char *path, bench_info_t *var)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        cerr << "warning: can't write the preset file " << path << endl;
+        return;
+    }
+
+    fprintf(file, "@prefix lv2:  <http://lv2plug.in/ns/lv2core#> .\n");
+    fprintf(file, "@prefix pset: <http://lv2plug.in/ns/ext/presets#> .\n");
+    fprintf(file, "@prefix rdfs: <http://www.w3.org/2000/01/rdf-schema#> .\n\n");
+    fprintf(file, "<>\n");
+    fprintf(file, "    a pset:Preset ;\n");
+    fprintf(file, "    lv2:appliesTo <%s> ;\n", plugin->uri.c_str());
+    fprintf(file, "    rdfs:label \"lv2bm worst case (%f%% JACK load)\"", var->jack_load);
+
+    std::map<uint32_t,port_data_t>::iterator it;
+    for (it = var->plugin_preset.begin(); it != var->plugin_preset.end(); ++it) {
+        fprintf(file, " ;\n    lv2:port [\n");
+        fprintf(file, "        lv2:symbol \"%s\" ;\n", it->second.symbol);
+        fprintf(file, "        pset:value %f\n", it->second.value);
+        fprintf(file, "    ]");
+    }
+    fprintf(file, " .\n");
+
+    fclose(file);
+}
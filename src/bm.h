@@ -18,44 +18,250 @@
 #ifndef BENCH_H
 #define BENCH_H
 
-#include <sndfile.hh>
-
 #include "plugin.h"
 #include "input_gen.h"
+#include "histogram.h"
+#include "timer.h"
+#include "covering.h"
+#include "writer.h"
+#include "perf.h"
+#include "rtcheck.h"
+
+// steady state detection of the automatic warm-up: windows of cycles and
+// maximum relative difference between the medians of consecutive windows
+#define WARMUP_WINDOW       32
+#define WARMUP_TOLERANCE    0.02
+// limit of the automatic warm-up, in seconds of audio
+#define WARMUP_AUTO_LIMIT   10.0
+
+// resamples of the bootstrap confidence interval of the repeated trials
+#define BOOTSTRAP_RESAMPLES 2000
+
+// unmeasured silence before each step of the polyphony test, in seconds of
+// audio, so the release tails of the previous notes are not measured
+#define POLYPHONY_SETTLE    1.0
 
 using namespace std;
 
 struct bench_info_t {
     double total, average, jack_load;
+
+    // per cycle statistics, in seconds
+    double p50, p90, p99, p999, max, stddev;
+    uint32_t worst_cycle;
+
+    // time of each cycle, in seconds (empty for the full test results)
+    std::vector<float> cycles;
+
+    // repeated trials: median JACK load, 95% bootstrap confidence interval and
+    // amount of trials disturbed by involuntary context switches
+    double load_median, load_ci_low, load_ci_high;
+    uint32_t trials, disturbed;
+
+    // performance counters (NAN when not available): instructions per clock,
+    // cache and branch misses per sample, page faults and context switches
+    // per cycle
+    double ipc, cache_misses, branch_misses, page_faults, context_switches;
+
+    // events of the output ports, the rate is per second of audio
+    uint64_t events, event_bytes, full_cycles;
+    double events_per_second;
+
     std::map<uint32_t,port_data_t> plugin_preset;
 };
 
+// emulation of the periods of a JACK server, times in seconds
+struct deadline_info_t {
+    uint32_t periods, xruns;
+    double period;
+
+    // min, 1st, 50th and 99th percentiles and max of the wake up delay at the
+    // period start and of the time left until the end of the period (slack,
+    // only the cycles without xrun)
+    double jitter[5], slack[5];
+};
+
+// flush to zero of the denormal numbers during the tests, both runs the tests
+// without and then with flushing
+enum ftz_mode_t {
+    FTZ_OFF,
+    FTZ_ON,
+    FTZ_BOTH
+};
+
+// how the cycles are split in calls to the plugin run function
+enum block_mode_t {
+    BLOCKS_FIXED,
+    BLOCKS_RANDOM,
+    BLOCKS_POW2,
+    BLOCKS_PATTERN
+};
+
+// calls of the variable block length test with lengths in [min_length, max_length]
+struct block_stats_t {
+    uint32_t min_length, max_length;
+    uint64_t calls, samples;
+    double time;
+};
+
+// load of the default values with a chord of N held notes
+struct polyphony_point_t {
+    uint32_t voices;
+    double average, jack_load;
+};
+
+enum sweep_mode_t {
+    SWEEP_EXHAUSTIVE,
+    SWEEP_COVERING,
+    SWEEP_SEARCH
+};
+
+// result of a full test combination, plain data so it can be exchanged between processes
+struct combination_t {
+    uint64_t index;
+    double total, average, jack_load;
+    double p50, p90, p99, p999, max, stddev;
+    uint32_t worst_cycle;
+};
+
 class Bench {
 private:
     void slice_parameters(void);
+    void set_result(bench_info_t *var, combination_t *result);
+    void test_shards(uint64_t n_combinations);
+    float port_value(port_data_t *port, double x);
+    float point_value(port_data_t *port, uint32_t point, uint32_t n_points);
+    double evaluate(std::vector<double> & point);
+    double run_cycle(uint32_t cycle);
+    uint32_t next_block_length(uint32_t cycle, uint32_t remaining);
+    void connect_audio(uint32_t offset);
+    void restore_inputs(void);
+    void merge_trials(bench_info_t *var, std::vector<bench_info_t> & trials);
+    uint32_t rand_int(void);
+    double rand_float(void);
+    uint32_t rseed;
     std::vector<uint32_t> params;
     Generator *generator;
-    SndfileHandle sndfile;
+    float *input_signal;
+    AudioWriter *writer;
+    std::vector<float*> output_buffers;
+    std::vector<float> cycles;
+    Histogram histogram;
+    PerfCounters *perf;
+
+    // CPUs of the benchmark thread before --cpu pinned it
+    std::vector<int> affinity;
 
 public:
     Bench(const char* uri, uint32_t sample_rate, uint32_t frame_size, uint32_t n_frames,
-          const char *signal, const char *output);
+          const char *signal, const char *output, block_mode_t blocks=BLOCKS_FIXED,
+          uint32_t seq_size=EVENT_BUFFER_SIZE);
     ~Bench();
 
+    void setup_realtime(void);
+    void setup_midi(void);
+    void setup_midi_output(void);
+    void restore_realtime(void);
+    void warm_up(void);
+    void run_deadline(deadline_info_t *info);
+    void run_blocks(void);
+    void run_polyphony(void);
     void run_and_calc(bench_info_t* var, bool save_output=false);
     void process(void);
-    void print(void);
-    void test_points(uint32_t depth, vector<uint32_t> & params, vector<uint32_t> & n_points);
+    void print(FILE *stream=stdout);
+    void print_cycles(FILE *stream, const char *test_name, bench_info_t *var);
+    void print_trials(FILE *stream, const char *test_name, bench_info_t *var);
+    void print_deadline(FILE *stream);
+    void print_blocks(FILE *stream);
+    void print_polyphony(FILE *stream);
+    void print_ftz(FILE *stream);
+    void print_counters(FILE *stream, const char *test_name, bench_info_t *var);
+    void print_events(FILE *stream, const char *test_name, bench_info_t *var);
+    void print_event_ports(FILE *stream);
+    void print_rt_check(FILE *stream);
+    double load(double cycle_time);
+    uint64_t count_combinations(bool exhaustive=false);
+    void set_combination(uint64_t index);
+    void add_combination(combination_t *result);
+    void test_combinations(uint64_t first, uint64_t last, FILE *results=NULL);
+    void print_combinations_table(FILE *stream);
+    void search_worst_case(void);
+    void save_preset(const char *path, bench_info_t *var);
 
     uint32_t sample_rate, frame_size, n_frames;
+    const char *signal;
     Plugin *plugin;
+    Timer *timer;
 
     bench_info_t min, max, def, smaller, bigger;
 
-    bool full_test;
+    bool full_test, print_combinations, zero_copy;
+    uint32_t jobs;
+
+    // warm-up cycles before the tests, warmup_auto stops at the steady state
+    uint32_t warmup, warmup_cycles;
+    bool warmup_auto;
+    double cold_cycle;
+
+    // trials of each of the min, max and def tests
+    uint32_t repeat;
+
+    // period deadline emulation with the default controls values
+    bool deadline;
+    deadline_info_t deadline_info;
+
+    // MIDI events sent to the MIDI inputs, only for the plugins which have them
+    const char *midi_pattern;
+    uint32_t voices;
+    MidiGenerator *midi;
+
+    // Standard MIDI File with the output events of the default values test
+    const char *midi_output;
+    MidiWriter *midi_writer;
+
+    // polyphony ramp up to the given number of voices (0 disables), the
+    // load is fitted as base + per_voice * voices
+    uint32_t polyphony;
+    std::vector<polyphony_point_t> polyphony_points;
+    double polyphony_base, polyphony_per_voice, max_voices;
+
+    // hardware and software performance counters of the tests
+    bool perf_counters;
+
+    // calls not realtime safe made by the plugin during all the tests
+    bool rt_check;
+    rtcheck_report_t rt_report;
+
+    // denormals handling, the tests with flushing are only run with FTZ_BOTH
+    ftz_mode_t ftz;
+    bench_info_t min_ftz, max_ftz, def_ftz;
+
+    // variable block length test with the default controls values, the
+    // pattern is only used by BLOCKS_PATTERN
+    block_mode_t blocks;
+    std::vector<uint32_t> block_pattern;
+    uint32_t block_position;
+    std::vector<block_stats_t> block_stats;
+    double blocks_jack_load;
+
+    // realtime setup of the benchmark thread, like a host audio thread. The
+    // priority 0 keeps SCHED_OTHER and the CPU -1 doesn't pin the thread
+    int rt_priority, cpu, worker_cpu;
+    bool lock_memory, prefault;
+
+    sweep_mode_t sweep;
+    uint32_t strength;
+    uint64_t n_combinations_tested;
+    CoveringArray *covering;
+
+    // adaptive search budget, zero means no limit
+    uint32_t search_budget;
+    double search_time;
+    std::vector< std::vector<float> > search_points;
 
     uint32_t n_points_default;
     std::vector<uint32_t> n_points_to_test;
+    std::vector<combination_t> combinations;
 };
 
 #endif
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "covering.h"
+
+// amount of rows built at each step, the one covering more tuples is kept
+#define ROW_CANDIDATES  32
+
+CoveringArray::CoveringArray(const std::vector<uint32_t> & levels, uint32_t strength)
+{
+    this->levels = levels;
+    this->strength = strength < levels.size() ? strength : levels.size();
+    rseed = 1;
+
+    for (uint32_t i = 0; i < levels.size(); i++) {
+        if (levels[i] == 0)
+            return;
+    }
+
+    if (this->strength == 0)
+        return;
+
+    create_subsets();
+
+    // greedy construction, one row at time until all tuples are covered
+    while (n_uncovered > 0) {
+        std::vector<int32_t> best_row;
+        uint32_t best_gain = 0;
+
+        for (uint32_t i = 0; i < ROW_CANDIDATES; i++) {
+            std::vector<int32_t> row(levels.size(), -1);
+            build_row(row);
+
+            uint32_t gain = row_gain(row);
+            if (gain > best_gain) {
+                best_gain = gain;
+                best_row = row;
+            }
+        }
+
+        cover_row(best_row);
+        rows.push_back(std::vector<uint32_t>(best_row.begin(), best_row.end()));
+    }
+}
+
+uint32_t CoveringArray::rand_int(uint32_t max)
+{
+    // 31bit Park-Miller-Carta Pseudo-Random Number Generator, same as the
+    // input signal generator, the seed is fixed so the array is reproducible
+    uint32_t hi, lo;
+    lo = 16807 * (rseed & 0xffff);
+    hi = 16807 * (rseed >> 16);
+
+    lo += (hi & 0x7fff) << 16;
+    lo += hi >> 15;
+    lo = (lo & 0x7fffffff) + (lo >> 31);
+    rseed = lo;
+
+    return rseed % max;
+}
+
+void CoveringArray::create_subsets(void)
+{
+    uint32_t n_params = levels.size();
+    std::vector<uint32_t> subset(strength);
+    for (uint32_t i = 0; i < strength; i++) subset[i] = i;
+
+    subsets_by_param.resize(n_params);
+    n_uncovered = 0;
+
+    // enumerate the subsets in lexicographic order
+    while (true) {
+        uint32_t n_tuples = 1;
+        for (uint32_t i = 0; i < strength; i++) {
+            n_tuples *= levels[subset[i]];
+            subsets_by_param[subset[i]].push_back(subsets.size());
+        }
+
+        subsets.push_back(subset);
+        covered.push_back(std::vector<bool>(n_tuples, false));
+        n_uncovered += n_tuples;
+
+        int32_t i = strength - 1;
+        while (i >= 0 && subset[i] == n_params - strength + i) i--;
+        if (i < 0)
+            break;
+
+        subset[i]++;
+        for (uint32_t j = i + 1; j < strength; j++) subset[j] = subset[j-1] + 1;
+    }
+}
+
+bool CoveringArray::tuple_index(uint32_t subset, const std::vector<int32_t> & row, uint32_t *index)
+{
+    *index = 0;
+    for (uint32_t i = 0; i < strength; i++) {
+        uint32_t param = subsets[subset][i];
+        if (row[param] < 0)
+            return false;
+
+        *index = *index * levels[param] + row[param];
+    }
+
+    return true;
+}
+
+uint32_t CoveringArray::row_gain(const std::vector<int32_t> & row)
+{
+    uint32_t gain = 0, index;
+    for (uint32_t i = 0; i < subsets.size(); i++) {
+        if (tuple_index(i, row, &index) && !covered[i][index]) gain++;
+    }
+
+    return gain;
+}
+
+void CoveringArray::build_row(std::vector<int32_t> & row)
+{
+    // start from a random uncovered tuple
+    uint32_t first = rand_int(subsets.size());
+    for (uint32_t i = 0; i < subsets.size(); i++) {
+        uint32_t subset = (first + i) % subsets.size();
+        std::vector<bool> & tuples = covered[subset];
+
+        uint32_t start = rand_int(tuples.size()), index = tuples.size();
+        for (uint32_t j = 0; j < tuples.size(); j++) {
+            if (!tuples[(start + j) % tuples.size()]) {
+                index = (start + j) % tuples.size();
+                break;
+            }
+        }
+
+        if (index == tuples.size())
+            continue;
+
+        // decode the tuple values
+        for (int32_t j = strength - 1; j >= 0; j--) {
+            uint32_t param = subsets[subset][j];
+            row[param] = index % levels[param];
+            index /= levels[param];
+        }
+        break;
+    }
+
+    // fill the remaining parameters in random order
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < row.size(); i++) {
+        if (row[i] < 0) order.push_back(i);
+    }
+
+    for (uint32_t i = order.size(); i > 1; i--) {
+        uint32_t j = rand_int(i);
+        uint32_t tmp = order[i-1];
+        order[i-1] = order[j];
+        order[j] = tmp;
+    }
+
+    for (uint32_t i = 0; i < order.size(); i++) {
+        uint32_t param = order[i];
+        uint32_t best_value = rand_int(levels[param]), best_gain = 0;
+
+        // value which covers more tuples among the already fixed parameters
+        for (uint32_t value = 0; value < levels[param]; value++) {
+            row[param] = value;
+
+            uint32_t gain = 0, index;
+            for (uint32_t j = 0; j < subsets_by_param[param].size(); j++) {
+                uint32_t subset = subsets_by_param[param][j];
+                if (tuple_index(subset, row, &index) && !covered[subset][index]) gain++;
+            }
+
+            if (gain > best_gain) {
+                best_gain = gain;
+                best_value = value;
+            }
+        }
+
+        row[param] = best_value;
+    }
+}
+
+void CoveringArray::cover_row(const std::vector<int32_t> & row)
+{
+    uint32_t index;
+    for (uint32_t i = 0; i < subsets.size(); i++) {
+        if (tuple_index(i, row, &index) && !covered[i][index]) {
+            covered[i][index] = true;
+            n_uncovered--;
+        }
+    }
+}
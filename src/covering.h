@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COVERING_H
+#define COVERING_H
+
+#include <stdint.h>
+#include <vector>
+
+// t-wise covering array: a set of rows such that, for any t parameters, each
+// combination of their levels appears in at least one row
+class CoveringArray {
+private:
+    std::vector<uint32_t> levels;
+    uint32_t strength;
+
+    // all subsets of 'strength' parameters and their covered tuples
+    std::vector< std::vector<uint32_t> > subsets;
+    std::vector< std::vector<bool> > covered;
+    std::vector< std::vector<uint32_t> > subsets_by_param;
+    uint64_t n_uncovered;
+
+    uint32_t rseed;
+    uint32_t rand_int(uint32_t max);
+
+    void create_subsets(void);
+    bool tuple_index(uint32_t subset, const std::vector<int32_t> & row, uint32_t *index);
+    uint32_t row_gain(const std::vector<int32_t> & row);
+    void build_row(std::vector<int32_t> & row);
+    void cover_row(const std::vector<int32_t> & row);
+
+public:
+    CoveringArray(const std::vector<uint32_t> & levels, uint32_t strength);
+
+    std::vector< std::vector<uint32_t> > rows;
+};
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // needed for CPU_SET and pthread_setaffinity_np
+#endif
+
+#include <sched.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#define MXCSR_DAZ (1 << 6)
+#define MXCSR_FTZ (1 << 15)
+#elif defined(__aarch64__) || defined(__arm__)
+#define FPCR_FZ (1 << 24)
+#endif
+
+#include "cpu.h"
+
+std::vector<int> cpu_allowed_list(void)
+{
+    std::vector<int> cpus;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &set)) cpus.push_back(i);
+        }
+    }
+
+    return cpus;
+}
+
+bool cpu_pin_thread(pthread_t thread, int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+bool cpu_set_affinity(pthread_t thread, const std::vector<int> & cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (uint32_t i = 0; i < cpus.size(); i++) {
+        CPU_SET(cpus[i], &set);
+    }
+
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+int cpu_set_realtime(pthread_t thread, int priority)
+{
+    struct sched_param param;
+    param.sched_priority = priority;
+
+    return pthread_setschedparam(thread, priority > 0 ? SCHED_FIFO : SCHED_OTHER, &param);
+}
+
+int cpu_lock_memory(void)
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        return errno;
+
+    return 0;
+}
+
+void cpu_prefault_stack(void)
+{
+    volatile char stack[PREFAULT_STACK_SIZE];
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    for (long i = 0; i < PREFAULT_STACK_SIZE; i += page_size) {
+        stack[i] = 0;
+    }
+
+    (void) stack;
+}
+
+#if defined(__aarch64__)
+static inline uint64_t get_fpcr(void)
+{
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r" (fpcr));
+    return fpcr;
+}
+
+static inline void set_fpcr(uint64_t fpcr)
+{
+    __asm__ __volatile__("msr fpcr, %0" : : "r" (fpcr));
+}
+#elif defined(__arm__) && defined(__ARM_FP)
+static inline uint32_t get_fpcr(void)
+{
+    uint32_t fpscr;
+    __asm__ __volatile__("vmrs %0, fpscr" : "=r" (fpscr));
+    return fpscr;
+}
+
+static inline void set_fpcr(uint32_t fpscr)
+{
+    __asm__ __volatile__("vmsr fpscr, %0" : : "r" (fpscr));
+}
+#endif
+
+bool cpu_flush_denormals(bool enable)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int mxcsr = _mm_getcsr();
+    if (enable) mxcsr |= MXCSR_FTZ | MXCSR_DAZ;
+    else mxcsr &= ~(MXCSR_FTZ | MXCSR_DAZ);
+    _mm_setcsr(mxcsr);
+    return true;
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_FP))
+    if (enable) set_fpcr(get_fpcr() | FPCR_FZ);
+    else set_fpcr(get_fpcr() & ~FPCR_FZ);
+    return true;
+#else
+    (void) enable;
+    return false;
+#endif
+}
+
+bool cpu_flushing_denormals(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (_mm_getcsr() & (MXCSR_FTZ | MXCSR_DAZ)) != 0;
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_FP))
+    return (get_fpcr() & FPCR_FZ) != 0;
+#else
+    return false;
+#endif
+}
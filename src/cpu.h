@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include <vector>
+#include <pthread.h>
+
+// amount of stack touched by cpu_prefault_stack
+#define PREFAULT_STACK_SIZE (256 * 1024)
+
+// list of the CPUs the process is allowed to run on
+std::vector<int> cpu_allowed_list(void);
+
+// pin the thread to a single CPU, returns false on failure
+bool cpu_pin_thread(pthread_t thread, int cpu);
+
+// allow the thread to run on the listed CPUs, returns false on failure
+bool cpu_set_affinity(pthread_t thread, const std::vector<int> & cpus);
+
+// run the thread with SCHED_FIFO and the given priority, priority 0 restores
+// SCHED_OTHER, returns the errno value (0 on success)
+int cpu_set_realtime(pthread_t thread, int priority);
+
+// lock the current and future pages of the process in memory, returns the
+// errno value (0 on success)
+int cpu_lock_memory(void);
+
+// touch the stack pages so the first calls don't page fault
+void cpu_prefault_stack(void);
+
+// flush the denormal numbers to zero in the calling thread (FTZ and DAZ on
+// x86, FZ on ARM), returns false if not supported by the architecture
+bool cpu_flush_denormals(bool enable);
+
+// whether the calling thread flushes the denormal numbers to zero
+bool cpu_flushing_denormals(void);
+
+#endif
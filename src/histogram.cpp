@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "histogram.h"
+
+Histogram::Histogram(void)
+{
+    reset();
+}
+
+void Histogram::reset(void)
+{
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    sum = sum_sq = 0.0;
+    min = max = 0.0;
+}
+
+uint32_t Histogram::bucket_index(uint64_t ns)
+{
+    if (ns < HISTOGRAM_SUB_COUNT)
+        return ns;
+
+    // position of the most significant bit defines the octave, the next
+    // HISTOGRAM_SUB_BITS bits define the linear bucket inside of it
+    uint32_t msb = 63 - __builtin_clzll(ns);
+    uint32_t shift = msb - HISTOGRAM_SUB_BITS;
+
+    return (shift + 1) * HISTOGRAM_SUB_COUNT + ((ns >> shift) - HISTOGRAM_SUB_COUNT);
+}
+
+double Histogram::bucket_value(uint32_t index)
+{
+    if (index < HISTOGRAM_SUB_COUNT)
+        return index * 1e-9;
+
+    uint32_t shift = index / HISTOGRAM_SUB_COUNT - 1;
+    uint64_t lower = (uint64_t) (index % HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_COUNT) << shift;
+    uint64_t width = (uint64_t) 1 << shift;
+
+    // middle of the bucket
+    return (lower + width * 0.5) * 1e-9;
+}
+
+void Histogram::add(double value)
+{
+    if (count == 0 || value < min) min = value;
+    if (count == 0 || value > max) max = value;
+
+    count++;
+    sum += value;
+    sum_sq += value * value;
+
+    double ns = value * 1e9 + 0.5;
+    buckets[bucket_index(ns > 0.0 ? (uint64_t) ns : 0)]++;
+}
+
+double Histogram::percentile(double p)
+{
+    if (count == 0)
+        return 0.0;
+
+    // rank of the requested sample, 1-based
+    uint64_t rank = (uint64_t) ceil(p / 100.0 * count);
+    if (rank < 1) rank = 1;
+
+    uint64_t accumulated = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        accumulated += buckets[i];
+        if (accumulated >= rank) {
+            double value = bucket_value(i);
+
+            // the exact extremes are known, keep the estimate inside them
+            if (value < min) value = min;
+            if (value > max) value = max;
+            return value;
+        }
+    }
+
+    return max;
+}
+
+double Histogram::mean(void)
+{
+    return count ? sum / count : 0.0;
+}
+
+double Histogram::stddev(void)
+{
+    if (count < 2)
+        return 0.0;
+
+    double average = mean();
+    double variance = (sum_sq - count * average * average) / (count - 1);
+    return variance > 0.0 ? sqrt(variance) : 0.0;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+// each power of two is split in 2^HISTOGRAM_SUB_BITS linear buckets, which
+// bounds the relative error of the reported percentiles to about 6%
+#define HISTOGRAM_SUB_BITS  4
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS   ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+
+// log-bucketed histogram of durations, the values are given in seconds
+// and stored with nanosecond resolution
+class Histogram {
+private:
+    uint32_t buckets[HISTOGRAM_BUCKETS];
+
+    static uint32_t bucket_index(uint64_t ns);
+    static double bucket_value(uint32_t index);
+
+public:
+    Histogram(void);
+
+    void reset(void);
+    void add(double value);
+    double percentile(double p);
+    double mean(void);
+    double stddev(void);
+
+    uint64_t count;
+    double sum, sum_sq, min, max;
+};
+
+#endif
@@ -35,6 +35,13 @@ Generator::Generator(uint32_t sample_rate, const char *signal, double duration)
     swp_log_b = log(f_max / f_min) / swp_period;
     swp_log_a = f_min / (swp_log_b * sample_rate);
 
+    // decaying signals, the fade reaches the denormal range at 85% of the
+    // duration (e^-100 of the signal level)
+    dcy_period = swp_period > 0 ? swp_period : 1;
+    dcy_cnt = 0;
+    fade_gain = 1.0;
+    fade_coeff = exp(-100.0 / dcy_period);
+
     rseed = time(NULL) % UINT_MAX;
     if (rseed == 0) rseed = 1;
 
@@ -58,10 +65,14 @@ Generator::Generator(uint32_t sample_rate, const char *signal, double duration)
     else if (strcmp(signal, "sweep") == 0) mode = 6;
     else if (strcmp(signal, "sawtooth") == 0) mode = 9;
     else if (strcmp(signal, "triangle") == 0) mode = 10;
+    else if (strcmp(signal, "decay") == 0) mode = 11;
+    else if (strcmp(signal, "fade") == 0) mode = 12;
+    else if (strcmp(signal, "burst") == 0) mode = 13;
 
     const char *signals_name[] = {"Sine Wave", "Square Wave", "Uniform White Noise",
         "Gaussian Shaped White Noise", "Pink Noise", "Impulse", "Sine Sweep", NULL, NULL,
-        "Sawtooth Wave", "Triangle Wave"};
+        "Sawtooth Wave", "Triangle Wave", "Impulse and Silence", "Fading Sine Wave",
+        "Noise Burst and Silence"};
 
     signal_name = signals_name[mode];
 }
@@ -85,11 +96,35 @@ float* Generator::get_frame(uint32_t n_samples)
     else if (mode <= 7) { gen_kroneker_delta(n_samples, k_period1); }
     else if (mode <= 8) { gen_kroneker_delta(n_samples, k_period5s); }
     else if (mode <= 9) { gen_sawtooth(n_samples, k_period100); }
-    else                { gen_triangle(n_samples, k_period100); }
+    else if (mode <= 10) { gen_triangle(n_samples, k_period100); }
+    else if (mode <= 11) { gen_decay(n_samples); }
+    else if (mode <= 12) { gen_fade(n_samples); }
+    else                { gen_burst(n_samples); }
 
     return output;
 }
 
+float* Generator::render(uint32_t n_samples, uint32_t block_size)
+{
+    // aligned to the cache line, the caller must release it using free
+    float *buffer;
+    if (posix_memalign((void **) &buffer, 64, (size_t) n_samples * sizeof(float)) != 0)
+        return NULL;
+
+    // generate the signal in place, block by block as done by get_frame
+    if (block_size == 0 || block_size > k_period1) block_size = k_period1;
+
+    float *frame_buffer = output;
+    for (uint64_t offset = 0; offset < n_samples; offset += block_size) {
+        uint32_t n = (n_samples - offset) < block_size ? (n_samples - offset) : block_size;
+        output = buffer + offset;
+        get_frame(n);
+    }
+    output = frame_buffer;
+
+    return buffer;
+}
+
 /* pseudo-random number generators */
 
 inline uint32_t Generator::rand_int(void)
@@ -276,3 +311,55 @@ void Generator::gen_sine_log_sweep(uint32_t n_samples)
 
     swp_cnt = _swp_cnt;
 }
+
+void Generator::gen_decay(uint32_t n_samples)
+{
+    // a single impulse, the plugin internal state (filters, reverb tails)
+    // decays into the denormal range during the silence
+    uint32_t _dcy_cnt = dcy_cnt;
+
+    for (uint32_t i = 0 ; i < n_samples; ++i) {
+        output[i] = _dcy_cnt == 0 ? 1.0f : 0.0f;
+        _dcy_cnt = (_dcy_cnt + 1) % dcy_period;
+    }
+
+    dcy_cnt = _dcy_cnt;
+}
+
+void Generator::gen_fade(uint32_t n_samples)
+{
+    // the gain is computed in double, so the signal itself goes through the
+    // float denormal range down to zero
+    float _phase = phase;
+    double _fade_gain = fade_gain;
+    uint32_t _dcy_cnt = dcy_cnt;
+    const double level = lvl_coeff_target;
+
+    for (uint32_t i = 0 ; i < n_samples; ++i) {
+        output[i] = level * _fade_gain * sinf(2.0f * M_PI * _phase);
+        _phase += phase_inc;
+        _fade_gain *= fade_coeff;
+
+        _dcy_cnt = (_dcy_cnt + 1) % dcy_period;
+        if (_dcy_cnt == 0) _fade_gain = 1.0;
+    }
+
+    phase = fmodf(_phase, 1.0);
+    fade_gain = _fade_gain;
+    dcy_cnt = _dcy_cnt;
+}
+
+void Generator::gen_burst(uint32_t n_samples)
+{
+    // white noise during the first 10% of the period, then silence
+    const float level = lvl_coeff_target;
+    const uint32_t burst_length = dcy_period / 10 > 0 ? dcy_period / 10 : 1;
+    uint32_t _dcy_cnt = dcy_cnt;
+
+    for (uint32_t i = 0 ; i < n_samples; ++i) {
+        output[i] = _dcy_cnt < burst_length ? level * rand_float() : 0.0f;
+        _dcy_cnt = (_dcy_cnt + 1) % dcy_period;
+    }
+
+    dcy_cnt = _dcy_cnt;
+}
@@ -37,6 +37,11 @@ private:
     uint32_t swp_period;
     uint32_t swp_cnt;
 
+    // decaying signals, one decay per period (the whole duration)
+    uint32_t dcy_period;
+    uint32_t dcy_cnt;
+    double fade_gain, fade_coeff;
+
     // pseudo-random number state
     uint32_t rseed;
     bool  g_pass;
@@ -55,6 +60,9 @@ private:
     void gen_sawtooth(uint32_t n_samples, const uint32_t period);
     void gen_triangle(uint32_t n_samples, const uint32_t period);
     void gen_sine_log_sweep(uint32_t n_samples);
+    void gen_decay(uint32_t n_samples);
+    void gen_fade(uint32_t n_samples);
+    void gen_burst(uint32_t n_samples);
 
 public:
     Generator(uint32_t sample_rate, const char *signal, double duration);
@@ -62,6 +70,7 @@ public:
 
     const char *signal_name;
     float* get_frame(uint32_t n_samples);
+    float* render(uint32_t n_samples, uint32_t block_size);
 };
 
 #endif
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "jobs.h"
+#include "cpu.h"
+
+struct task_data_t {
+    pid_t pid;
+    FILE *output, *data;
+    bool done;
+    int status;
+};
+
+JobPool::JobPool(uint32_t n_jobs)
+{
+    cpus = cpu_allowed_list();
+
+    // without the affinity mask the online CPUs are the limit
+    uint32_t n_cpus = cpus.size();
+    if (cpus.empty()) {
+        std::cerr << "warning: can't get the CPUs affinity, the jobs will not be pinned" << std::endl;
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        n_cpus = online > 0 ? online : 1;
+    }
+
+    // one process per CPU, otherwise the jobs disturb each other
+    if (n_jobs > n_cpus) {
+        std::cerr << "warning: only " << n_cpus << " CPUs available, using "
+                  << n_cpus << " jobs" << std::endl;
+        n_jobs = n_cpus;
+    }
+
+    this->n_jobs = n_jobs > 0 ? n_jobs : 1;
+}
+
+static void copy_stream(FILE *src, FILE *dst)
+{
+    char buffer[4096];
+    size_t size;
+
+    rewind(src);
+    while ((size = fread(buffer, 1, sizeof(buffer), src)) > 0) {
+        fwrite(buffer, 1, size, dst);
+    }
+}
+
+uint32_t JobPool::run(Job *job, uint32_t n_tasks)
+{
+    std::vector<task_data_t> tasks(n_tasks);
+    std::vector<pid_t> slots(n_jobs, 0);
+    uint32_t next_task = 0, next_finish = 0, failures = 0;
+
+    while (next_finish < n_tasks) {
+        // start a task on each free slot
+        for (uint32_t slot = 0; slot < n_jobs && next_task < n_tasks; slot++) {
+            if (slots[slot] != 0)
+                continue;
+
+            task_data_t *task = &tasks[next_task];
+            task->output = tmpfile();
+            task->data = tmpfile();
+            task->done = false;
+            task->status = 0;
+
+            if (!task->output || !task->data) {
+                std::cerr << "error: can't create the temporary files of the job" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            // avoid the child to print the parent pending buffers
+            std::cout.flush();
+            fflush(NULL);
+
+            pid_t pid = fork();
+            if (pid == 0) {
+                // without the affinity list the jobs are not pinned
+                if (slot < cpus.size() && !cpu_pin_thread(pthread_self(), cpus[slot])) {
+                    std::cerr << "warning: can't pin the job to CPU " << cpus[slot] << std::endl;
+                }
+
+                dup2(fileno(task->output), STDOUT_FILENO);
+
+                int ret = job->run(next_task, task->data);
+
+                std::cout.flush();
+                fflush(NULL);
+                _exit(ret);
+            }
+            else if (pid < 0) {
+                std::cerr << "error: can't create the job process" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            task->pid = pid;
+            slots[slot] = pid;
+            next_task++;
+        }
+
+        // wait any task to finish
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0)
+            break;
+
+        for (uint32_t slot = 0; slot < n_jobs; slot++) {
+            if (slots[slot] == pid) slots[slot] = 0;
+        }
+
+        for (uint32_t i = next_finish; i < next_task; i++) {
+            if (tasks[i].pid == pid) {
+                tasks[i].done = true;
+                tasks[i].status = status;
+            }
+        }
+
+        // finish the tasks keeping the order
+        while (next_finish < next_task && tasks[next_finish].done) {
+            task_data_t *task = &tasks[next_finish];
+
+            copy_stream(task->output, stdout);
+            fflush(stdout);
+
+            rewind(task->data);
+            job->finish(next_finish, task->status, task->data);
+
+            if (!WIFEXITED(task->status) || WEXITSTATUS(task->status) != 0)
+                failures++;
+
+            fclose(task->output);
+            fclose(task->data);
+            next_finish++;
+        }
+    }
+
+    return failures;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/**
+   A task list which can be executed in separated processes.
+*/
+class Job {
+public:
+    virtual ~Job() {}
+
+    /**
+       Execute the task (child process). Everything written to the standard
+       output is printed by the pool in the tasks order. The data stream is
+       private to the task and is handed to finish.
+       @return the process exit status.
+    */
+    virtual int run(uint32_t task, FILE *data) = 0;
+
+    /**
+       Handle the end of the task (parent process), called in the tasks order.
+       @param status the status returned by waitpid
+    */
+    virtual void finish(uint32_t task, int status, FILE *data) = 0;
+};
+
+/**
+   A pool of processes, each one pinned to its own CPU.
+*/
+class JobPool {
+public:
+    JobPool(uint32_t n_jobs);
+
+    /**
+       Execute the tasks 0 to n_tasks - 1 of the job.
+       @return the number of tasks which did not exit with success.
+    */
+    uint32_t run(Job *job, uint32_t n_tasks);
+
+    uint32_t n_jobs;
+
+private:
+    std::vector<int> cpus;
+};
+
+#endif
@@ -17,15 +17,316 @@
 
 #include <iostream>
 #include "bm.h"
+#include "jobs.h"
+#include "report.h"
+#include "baseline.h"
+#include "scaling.h"
 
 #include <stdlib.h>
 #include <getopt.h>
+#include <string.h>
+#include <sys/wait.h>
 
 using namespace std;
 
 // software version
 const char version[] = "v1.1";
 
+// options without short version
+enum {
+    OPT_PRINT_COMBINATIONS = 256,
+    OPT_SWEEP,
+    OPT_STRENGTH,
+    OPT_BUDGET,
+    OPT_TIME_LIMIT,
+    OPT_PRESET,
+    OPT_ZERO_COPY,
+    OPT_FORMAT,
+    OPT_REPORT,
+    OPT_BASELINE,
+    OPT_THRESHOLD,
+    OPT_ALPHA,
+    OPT_WARMUP,
+    OPT_REPEAT,
+    OPT_RT_PRIORITY,
+    OPT_CPU,
+    OPT_WORKER_CPU,
+    OPT_MLOCK,
+    OPT_PREFAULT,
+    OPT_DEADLINE,
+    OPT_BLOCKS,
+    OPT_FTZ,
+    OPT_PERF,
+    OPT_RT_CHECK,
+    OPT_MIDI,
+    OPT_VOICES,
+    OPT_POLYPHONY,
+    OPT_MIDI_OUTPUT,
+    OPT_SEQ_SIZE
+};
+
+// exit status of a benchmark slower than the baseline
+#define EXIT_REGRESSION 2
+
+struct options_t {
+    std::vector<unsigned int> rates, frame_sizes, block_pattern;
+    unsigned int n_frames, jobs, strength, budget, warmup, repeat, voices, polyphony;
+    unsigned int seq_size;
+    double time_limit;
+    int rt_priority, cpu, worker_cpu;
+    bool full_test, print_combinations, zero_copy, warmup_auto, lock_memory, prefault, deadline,
+         perf, rt_check;
+    sweep_mode_t sweep;
+    block_mode_t blocks;
+    ftz_mode_t ftz;
+    const char *input_signal, *midi_pattern, *output, *midi_output, *clock_source, *preset;
+    report_format_t format;
+    FILE *report;
+    Baseline *baseline;
+    Timer *timer;
+};
+
+struct setting_t {
+    unsigned int rate, frame_size, n_frames;
+    const char *input_signal;
+    bool suffix;
+};
+
+// one second of audio, at least one frame when the frame is longer
+static unsigned int default_frames(unsigned int rate, unsigned int frame_size)
+{
+    return rate >= frame_size ? rate / frame_size : 1;
+}
+
+// with several settings each one writes its own files, e.g. out-48000-128.flac
+static std::string setting_path(const char *path, setting_t *setting)
+{
+    std::string name(path);
+    if (!setting->suffix)
+        return name;
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "-%u-%u", setting->rate, setting->frame_size);
+
+    size_t dot = name.rfind('.'), slash = name.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = name.size();
+
+    return name.insert(dot, suffix);
+}
+
+// the results go to the report file when given, otherwise stdout uses the selected format
+static int bench_setting(const char *uri, options_t *opts, FILE *report, setting_t *setting,
+                         Scaling *scaling)
+{
+    Report stdout_report(opts->report ? REPORT_TABLE : opts->format, stdout);
+
+    std::string output, midi_output, preset;
+    if (opts->output) output = setting_path(opts->output, setting);
+    if (opts->midi_output) midi_output = setting_path(opts->midi_output, setting);
+    if (opts->preset) preset = setting_path(opts->preset, setting);
+
+    try {
+        Bench bench = Bench(uri, setting->rate, setting->frame_size, setting->n_frames, setting->input_signal,
+                            opts->output ? output.c_str() : NULL, opts->blocks, opts->seq_size);
+        bench.full_test = opts->full_test;
+        bench.print_combinations = opts->print_combinations;
+        bench.zero_copy = opts->zero_copy;
+        bench.jobs = opts->jobs;
+        bench.sweep = opts->sweep;
+        bench.strength = opts->strength;
+        bench.search_budget = opts->budget;
+        bench.search_time = opts->time_limit;
+        bench.warmup = opts->warmup;
+        bench.warmup_auto = opts->warmup_auto;
+        bench.repeat = opts->repeat;
+        bench.rt_priority = opts->rt_priority;
+        bench.cpu = opts->cpu;
+        bench.worker_cpu = opts->worker_cpu;
+        bench.lock_memory = opts->lock_memory;
+        bench.prefault = opts->prefault;
+        bench.deadline = opts->deadline;
+        bench.ftz = opts->ftz;
+        bench.perf_counters = opts->perf;
+        bench.rt_check = opts->rt_check;
+        bench.midi_pattern = opts->midi_pattern;
+        bench.voices = opts->voices;
+        bench.polyphony = opts->polyphony;
+        bench.midi_output = opts->midi_output ? midi_output.c_str() : NULL;
+        bench.block_pattern.assign(opts->block_pattern.begin(), opts->block_pattern.end());
+        bench.timer = opts->timer;
+        bench.process();
+        scaling->add(&bench);
+
+        std::vector<comparison_t> comparisons;
+        if (opts->baseline)
+            comparisons = opts->baseline->compare(&bench);
+
+        fflush(stdout);
+        stdout_report.write(&bench, opts->baseline ? &comparisons : NULL);
+        if (report) {
+            Report file_report(opts->format, report);
+            file_report.write(&bench, opts->baseline ? &comparisons : NULL);
+        }
+
+        if (opts->preset && bench.full_test)
+            bench.save_preset(preset.c_str(), &bench.bigger);
+
+        for (uint32_t i = 0; i < comparisons.size(); i++) {
+            if (comparisons[i].regression) return EXIT_REGRESSION;
+        }
+    }
+    catch(exception& e) {
+        fflush(stdout);
+        stdout_report.write_error(uri, e.what());
+        if (report) {
+            Report file_report(opts->format, report);
+            file_report.write_error(uri, e.what());
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+// benchmarks the plugin with each rate and frame size
+static int bench_uri(const char *uri, options_t *opts, FILE *report)
+{
+    std::vector<setting_t> settings;
+
+    // the plugin is benchmarked with the same settings of the baseline
+    for (uint32_t i = 0; opts->baseline && i < opts->baseline->entries.size(); i++) {
+        baseline_entry_t *entry = &opts->baseline->entries[i];
+        if (entry->uri != uri)
+            continue;
+
+        bool repeated = false;
+        for (uint32_t j = 0; j < settings.size(); j++) {
+            if (settings[j].rate == entry->rate && settings[j].frame_size == entry->frame_size)
+                repeated = true;
+        }
+        if (repeated || entry->rate == 0 || entry->frame_size == 0)
+            continue;
+
+        // the last result of the same settings is the one compared
+        entry = opts->baseline->find(uri, entry->rate, entry->frame_size);
+
+        setting_t setting;
+        setting.rate = entry->rate;
+        setting.frame_size = entry->frame_size;
+        setting.n_frames = entry->n_frames ? entry->n_frames : default_frames(entry->rate, entry->frame_size);
+        setting.input_signal = entry->signal.empty() ? opts->input_signal : entry->signal.c_str();
+        settings.push_back(setting);
+    }
+
+    // otherwise all the combinations of the given rates and frame sizes, by
+    // default each one runs one second of audio
+    if (settings.empty()) {
+        for (uint32_t i = 0; i < opts->rates.size(); i++) {
+            for (uint32_t j = 0; j < opts->frame_sizes.size(); j++) {
+                setting_t setting;
+                setting.rate = opts->rates[i];
+                setting.frame_size = opts->frame_sizes[j];
+                setting.n_frames = opts->n_frames ? opts->n_frames : default_frames(setting.rate, setting.frame_size);
+                setting.input_signal = opts->input_signal;
+                settings.push_back(setting);
+            }
+        }
+    }
+
+    int status = 0;
+    Scaling scaling;
+    for (uint32_t i = 0; i < settings.size(); i++) {
+        settings[i].suffix = settings.size() > 1;
+        int ret = bench_setting(uri, opts, report, &settings[i], &scaling);
+        if (ret == EXIT_REGRESSION || (ret != 0 && status == 0))
+            status = ret;
+    }
+
+    // per call overhead versus per sample cost
+    if (scaling.points.size() > 1) {
+        scaling.fit();
+
+        Report stdout_report(opts->report ? REPORT_TABLE : opts->format, stdout);
+        stdout_report.write_scaling(uri, &scaling);
+        if (report) {
+            Report file_report(opts->format, report);
+            file_report.write_scaling(uri, &scaling);
+        }
+    }
+
+    return status;
+}
+
+// comma separated list of positive numbers
+static bool parse_list(const char *arg, std::vector<unsigned int> *list)
+{
+    list->clear();
+
+    const char *p = arg;
+    while (*p) {
+        char *end;
+        long value = strtol(p, &end, 10);
+        if (end == p || value <= 0 || (*end != ',' && *end != '\0'))
+            return false;
+
+        list->push_back(value);
+        p = *end ? end + 1 : end;
+    }
+
+    return !list->empty();
+}
+
+// benchmarks each URI in its own process
+class BenchJob : public Job {
+public:
+    BenchJob(char **uris, options_t *opts) : regressions(0), uris(uris), opts(opts) {}
+
+    int run(uint32_t task, FILE *data)
+    {
+        // the jobs are already running in parallel, so the full test is not split
+        options_t job_opts = *opts;
+        job_opts.jobs = 1;
+
+        // the report record goes through the data file, the parent writes it in order
+        return bench_uri(uris[task], &job_opts, opts->report ? data : NULL);
+    }
+
+    void finish(uint32_t task, int status, FILE *data)
+    {
+        if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_REGRESSION)
+            regressions++;
+
+        if (WIFSIGNALED(status)) {
+            char error[256];
+            snprintf(error, sizeof(error), "Benchmark terminated by signal %d (%s)",
+                     WTERMSIG(status), strsignal(WTERMSIG(status)));
+
+            Report stdout_report(opts->report ? REPORT_TABLE : opts->format, stdout);
+            stdout_report.write_error(uris[task], error);
+            if (opts->report) {
+                Report file_report(opts->format, opts->report);
+                file_report.write_error(uris[task], error);
+            }
+            return;
+        }
+
+        if (opts->report) {
+            char buffer[4096];
+            size_t n;
+            while ((n = fread(buffer, 1, sizeof(buffer), data)) > 0)
+                fwrite(buffer, 1, n, opts->report);
+            fflush(opts->report);
+        }
+    }
+
+    uint32_t regressions;
+
+private:
+    char **uris;
+    options_t *opts;
+};
+
 int main(int argc, char *argv[])
 {
     static struct option long_options[] = {
@@ -34,19 +335,83 @@ int main(int argc, char *argv[])
         {"frame-size", required_argument, 0, 'f'},
         {"n-frames", required_argument, 0, 'n'},
         {"full-test", no_argument, 0, 't'},
+        {"print-combinations", no_argument, 0, OPT_PRINT_COMBINATIONS},
+        {"sweep", required_argument, 0, OPT_SWEEP},
+        {"strength", required_argument, 0, OPT_STRENGTH},
+        {"budget", required_argument, 0, OPT_BUDGET},
+        {"time-limit", required_argument, 0, OPT_TIME_LIMIT},
+        {"preset", required_argument, 0, OPT_PRESET},
         {"input", required_argument, 0, 'i'},
         {"output", required_argument, 0, 'o'},
+        {"zero-copy", no_argument, 0, OPT_ZERO_COPY},
+        {"format", required_argument, 0, OPT_FORMAT},
+        {"report", required_argument, 0, OPT_REPORT},
+        {"baseline", required_argument, 0, OPT_BASELINE},
+        {"threshold", required_argument, 0, OPT_THRESHOLD},
+        {"alpha", required_argument, 0, OPT_ALPHA},
+        {"warmup", required_argument, 0, OPT_WARMUP},
+        {"repeat", required_argument, 0, OPT_REPEAT},
+        {"rt-priority", required_argument, 0, OPT_RT_PRIORITY},
+        {"cpu", required_argument, 0, OPT_CPU},
+        {"worker-cpu", required_argument, 0, OPT_WORKER_CPU},
+        {"mlock", no_argument, 0, OPT_MLOCK},
+        {"prefault", no_argument, 0, OPT_PREFAULT},
+        {"deadline", no_argument, 0, OPT_DEADLINE},
+        {"blocks", required_argument, 0, OPT_BLOCKS},
+        {"ftz", required_argument, 0, OPT_FTZ},
+        {"perf", no_argument, 0, OPT_PERF},
+        {"rt-check", no_argument, 0, OPT_RT_CHECK},
+        {"midi", required_argument, 0, OPT_MIDI},
+        {"voices", required_argument, 0, OPT_VOICES},
+        {"polyphony", required_argument, 0, OPT_POLYPHONY},
+        {"midi-output", required_argument, 0, OPT_MIDI_OUTPUT},
+        {"seq-size", required_argument, 0, OPT_SEQ_SIZE},
+        {"clock", required_argument, 0, 'c'},
+        {"jobs", required_argument, 0, 'j'},
         {"version", no_argument, 0, 'V'},
         {0, 0, 0, 0}
     };
 
     // default options values
-    unsigned int rate = 48000, frame_size = 128, n_frames = rate / frame_size;
-    bool full_test = false;
-
-    const char *default_input_signal = "sine";
-    const char *input_signal = default_input_signal;
-    const char *output = 0;
+    options_t opts;
+    opts.rates.push_back(48000);
+    opts.frame_sizes.push_back(128);
+    opts.n_frames = 0;
+    opts.jobs = 1;
+    opts.full_test = false;
+    opts.print_combinations = false;
+    opts.zero_copy = false;
+    opts.warmup = 0;
+    opts.warmup_auto = false;
+    opts.repeat = 1;
+    opts.rt_priority = 0;
+    opts.cpu = -1;
+    opts.worker_cpu = -1;
+    opts.lock_memory = false;
+    opts.prefault = false;
+    opts.deadline = false;
+    opts.blocks = BLOCKS_FIXED;
+    opts.ftz = FTZ_OFF;
+    opts.perf = false;
+    opts.rt_check = false;
+    opts.sweep = SWEEP_EXHAUSTIVE;
+    opts.strength = 2;
+    opts.budget = 100;
+    opts.time_limit = 0.0;
+    opts.preset = 0;
+    opts.input_signal = "sine";
+    opts.midi_pattern = "chords";
+    opts.voices = 4;
+    opts.polyphony = 0;
+    opts.seq_size = EVENT_BUFFER_SIZE;
+    opts.output = 0;
+    opts.midi_output = 0;
+    opts.clock_source = "monotonic";
+    opts.format = REPORT_TABLE;
+    opts.report = 0;
+    opts.baseline = 0;
+    const char *report_path = 0, *baseline_path = 0;
+    double threshold = 5.0, alpha = 0.01;
 
     bool no_arguments_passed = false;
     if (argc < 2)
@@ -54,31 +419,256 @@ int main(int argc, char *argv[])
 
     // parse the command line options
     int opt, option_index;
-    while ((opt = getopt_long(argc, argv, "hr:f:n:ti:o:V", long_options, &option_index)) != -1 ||
+    while ((opt = getopt_long(argc, argv, "hr:f:n:ti:o:c:j:V", long_options, &option_index)) != -1 ||
            no_arguments_passed) {
         switch (opt) {
         case 'r':
-            rate = atoi(optarg);
+            if (!parse_list(optarg, &opts.rates)) {
+                cout << "Invalid sample rate: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
             break;
 
         case 'f':
-            frame_size = atoi(optarg);
+            if (!parse_list(optarg, &opts.frame_sizes)) {
+                cout << "Invalid frame size: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
             break;
 
         case 'n':
-            n_frames = atoi(optarg);
+            opts.n_frames = atoi(optarg);
             break;
 
         case 't':
-            full_test = true;
+            opts.full_test = true;
+            break;
+
+        case OPT_REPEAT:
+            opts.repeat = atoi(optarg);
+            if (opts.repeat < 1) {
+                cout << "Invalid number of trials: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case OPT_WARMUP:
+            if (strcmp(optarg, "auto") == 0) {
+                opts.warmup_auto = true;
+            }
+            else {
+                opts.warmup = atoi(optarg);
+                opts.warmup_auto = false;
+            }
+            break;
+
+        case OPT_PRINT_COMBINATIONS:
+            opts.print_combinations = true;
+            break;
+
+        case OPT_SWEEP:
+            if (strcmp(optarg, "exhaustive") == 0) {
+                opts.sweep = SWEEP_EXHAUSTIVE;
+            }
+            else if (strcmp(optarg, "covering") == 0) {
+                opts.sweep = SWEEP_COVERING;
+            }
+            else if (strcmp(optarg, "search") == 0) {
+                opts.sweep = SWEEP_SEARCH;
+            }
+            else {
+                cout << "Invalid sweep mode: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case OPT_BUDGET:
+            opts.budget = atoi(optarg);
+            break;
+
+        case OPT_TIME_LIMIT:
+            opts.time_limit = atof(optarg);
+            break;
+
+        case OPT_PRESET:
+            opts.preset = optarg;
+            break;
+
+        case OPT_STRENGTH:
+            opts.strength = atoi(optarg);
+            if (opts.strength < 1) {
+                cout << "Invalid covering array strength: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
             break;
 
         case 'i':
-            input_signal = optarg;
+            opts.input_signal = optarg;
             break;
 
         case 'o':
-            output = optarg;
+            opts.output = optarg;
+            break;
+
+        case OPT_ZERO_COPY:
+            opts.zero_copy = true;
+            break;
+
+        case OPT_FORMAT:
+            if (strcmp(optarg, "table") == 0) {
+                opts.format = REPORT_TABLE;
+            }
+            else if (strcmp(optarg, "json") == 0) {
+                opts.format = REPORT_JSON;
+            }
+            else if (strcmp(optarg, "csv") == 0) {
+                opts.format = REPORT_CSV;
+            }
+            else {
+                cout << "Invalid report format: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case OPT_REPORT:
+            report_path = optarg;
+            break;
+
+        case OPT_BASELINE:
+            baseline_path = optarg;
+            break;
+
+        case OPT_THRESHOLD:
+            threshold = atof(optarg);
+            break;
+
+        case OPT_ALPHA:
+            alpha = atof(optarg);
+            if (alpha <= 0.0 || alpha >= 1.0) {
+                cout << "Invalid significance level: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case OPT_RT_PRIORITY:
+            opts.rt_priority = atoi(optarg);
+            if (opts.rt_priority < 0 || opts.rt_priority > 99) {
+                cout << "Invalid realtime priority: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case OPT_CPU:
+            opts.cpu = atoi(optarg);
+            break;
+
+        case OPT_WORKER_CPU:
+            opts.worker_cpu = atoi(optarg);
+            break;
+
+        case OPT_MLOCK:
+            opts.lock_memory = true;
+            break;
+
+        case OPT_PREFAULT:
+            opts.prefault = true;
+            break;
+
+        case OPT_DEADLINE:
+            opts.deadline = true;
+            break;
+
+        case OPT_PERF:
+            opts.perf = true;
+            break;
+
+        case OPT_RT_CHECK:
+            opts.rt_check = true;
+            break;
+
+        case OPT_MIDI:
+            if (strcmp(optarg, "none") != 0 && strcmp(optarg, "notes") != 0 && strcmp(optarg, "chords") != 0 &&
+                strcmp(optarg, "held") != 0 && strcmp(optarg, "cc") != 0 && strcmp(optarg, "bend") != 0 &&
+                strcmp(optarg, "random") != 0) {
+                cout << "Invalid MIDI pattern: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
+            opts.midi_pattern = optarg;
+            break;
+
+        case OPT_SEQ_SIZE: {
+            char *end;
+            long size = strtol(optarg, &end, 10);
+            if (end == optarg || *end != '\0' || size < MINIMUM_SEQ_SIZE || size > MAXIMUM_SEQ_SIZE) {
+                cout << "Invalid sequence size: " << optarg << " (" << MINIMUM_SEQ_SIZE << " to "
+                     << MAXIMUM_SEQ_SIZE << " bytes)" << endl;
+                exit(EXIT_FAILURE);
+            }
+            opts.seq_size = size;
+            break;
+        }
+
+        case OPT_MIDI_OUTPUT:
+            opts.midi_output = optarg;
+            break;
+
+        case OPT_POLYPHONY:
+            opts.polyphony = atoi(optarg);
+            if (opts.polyphony < 1 || opts.polyphony > MIDI_MAX_VOICES) {
+                cout << "Invalid number of voices: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case OPT_VOICES:
+            opts.voices = atoi(optarg);
+            if (opts.voices < 1 || opts.voices > MIDI_MAX_VOICES) {
+                cout << "Invalid number of voices: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case OPT_FTZ:
+            if (strcmp(optarg, "off") == 0) {
+                opts.ftz = FTZ_OFF;
+            }
+            else if (strcmp(optarg, "on") == 0) {
+                opts.ftz = FTZ_ON;
+            }
+            else if (strcmp(optarg, "both") == 0) {
+                opts.ftz = FTZ_BOTH;
+            }
+            else {
+                cout << "Invalid FTZ mode: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case OPT_BLOCKS:
+            if (strcmp(optarg, "fixed") == 0) {
+                opts.blocks = BLOCKS_FIXED;
+            }
+            else if (strcmp(optarg, "random") == 0) {
+                opts.blocks = BLOCKS_RANDOM;
+            }
+            else if (strcmp(optarg, "pow2") == 0) {
+                opts.blocks = BLOCKS_POW2;
+            }
+            else if (parse_list(optarg, &opts.block_pattern)) {
+                opts.blocks = BLOCKS_PATTERN;
+            }
+            else {
+                cout << "Invalid block lengths mode: " << optarg << endl;
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case 'c':
+            opts.clock_source = optarg;
+            break;
+
+        case 'j':
+            opts.jobs = atoi(optarg);
             break;
 
         case 'V':
@@ -91,14 +681,42 @@ int main(int argc, char *argv[])
         default:
         case 'h':
             cout << "Usage: " << argv[0] << " [OPTIONS] URIs" << endl;
-            cout << "  -r, --rate            Defines the sample rate. Default: " << rate << endl << endl;
+            cout << "  -r, --rate            Defines the sample rate, a comma separated list benchmarks" << endl;
+            cout << "                        each rate. Default: " << opts.rates[0] << endl << endl;
             cout << "  -f, --frame-size      Defines the frame size. Equivalent to option -p of the JACK." << endl;
-            cout << "                        Default: " << frame_size << endl << endl;
+            cout << "                        A comma separated list benchmarks each frame size with each" << endl;
+            cout << "                        rate and prints how the load scales with the frame size." << endl;
+            cout << "                        The output files get the rate and frame size in their names." << endl;
+            cout << "                        Default: " << opts.frame_sizes[0] << endl << endl;
             cout << "  -n, --n-frames        Defines the number of frames, i.e. how many times the 'run'" << endl;
-            cout << "                        function of the plugin executes. Default: " << n_frames << endl << endl;
+            cout << "                        function of the plugin executes. Default: rate / frame-size" << endl;
+            cout << "                        (one second of audio)" << endl << endl;
+            cout << "  --warmup N|auto       Run N cycles with the default controls values before the" << endl;
+            cout << "                        tests. With 'auto' the warm-up stops when the cycle times" << endl;
+            cout << "                        are stable. The first cycle is reported as the cold start." << endl;
+            cout << "                        Default: 0" << endl << endl;
+            cout << "  --repeat K            Run K interleaved trials of the min, def and max tests and" << endl;
+            cout << "                        report the median JACK load with its 95% confidence interval." << endl;
+            cout << "                        Trials preempted by other processes are rejected. Default: 1" << endl << endl;
             cout << "  --full-test           Run the plugins using differents controls values combinations." << endl;
             cout << "                        This test might take a long time depending on the amount of" << endl;
-            cout << "                        controls the plugin has." << endl << endl;
+            cout << "                        controls the plugin has. When a single URI is given, the" << endl;
+            cout << "                        combinations are split among the jobs (see --jobs)." << endl << endl;
+            cout << "  --print-combinations  Print the result of each combination of the full test." << endl << endl;
+            cout << "  --sweep MODE          Select how the full test combines the controls values." << endl;
+            cout << "                        Valid modes:" << endl;
+            cout << "                          exhaustive: All combinations (default)" << endl;
+            cout << "                          covering:   Covering array, each combination of values of" << endl;
+            cout << "                                      any 'strength' controls is tested at least once" << endl;
+            cout << "                          search:     Adaptive search (simulated annealing) of the" << endl;
+            cout << "                                      controls values which maximize the JACK load" << endl << endl;
+            cout << "  --strength T          Strength of the covering array. Default: 2 (pairwise)" << endl << endl;
+            cout << "  --budget N            Maximum number of evaluations of the search, 0 means no" << endl;
+            cout << "                        limit. Default: " << opts.budget << endl << endl;
+            cout << "  --time-limit S        Maximum time in seconds of the search. Default: no limit" << endl << endl;
+            cout << "  --preset FILE         Save the controls values of the worst result of the full" << endl;
+            cout << "                        test as a LV2 preset (Turtle) file. Only one plugin can be" << endl;
+            cout << "                        tested with this option." << endl << endl;
             cout << "  -i, --input           Select the signal to apply to the audio inputs of the plugin." << endl;
             cout << "                        Valid inputs:" << endl;
             cout << "                          sine:       Sine wave 1kHz" << endl;
@@ -109,9 +727,91 @@ int main(int argc, char *argv[])
             cout << "                          pink:       Pink noise" << endl;
             cout << "                          impulse:    1 sample spike 100Hz, 0dBFS" << endl;
             cout << "                          sawtooth:   Sawtooth wave 100Hz" << endl;
-            cout << "                          triangle:   Triangle wave 100Hz" << endl << endl;
+            cout << "                          triangle:   Triangle wave 100Hz" << endl;
+            cout << "                          decay:      1 sample spike 0dBFS followed by silence" << endl;
+            cout << "                          fade:       Sine wave 1kHz fading into the denormal range" << endl;
+            cout << "                          burst:      White noise burst (10%) followed by silence" << endl << endl;
+            cout << "  --midi PATTERN        Select the MIDI events sent to the MIDI inputs of the plugin." << endl;
+            cout << "                        Valid patterns:" << endl;
+            cout << "                          none:       Empty sequence" << endl;
+            cout << "                          notes:      One note every 250ms" << endl;
+            cout << "                          chords:     One chord of N voices every second (default)" << endl;
+            cout << "                          held:       One chord of N voices held all the time" << endl;
+            cout << "                          cc:         Held chord with CC 1 and 74 sweeps" << endl;
+            cout << "                          bend:       Held chord with a pitch bend sweep" << endl;
+            cout << "                          random:     Random notes and controllers, fixed seed" << endl << endl;
+            cout << "  --voices N            Maximum number of notes playing at once. Default: 4" << endl << endl;
+            cout << "  --polyphony N         After the tests, hold chords of 1, 2, 4 ... N voices and estimate" << endl;
+            cout << "                        the maximum number of voices before 100% of the JACK load." << endl << endl;
             cout << "  -o, --output FILE     Write the plugin outputs to a FLAC file. The generated file" << endl;
-            cout << "                        contains the audio using the default values of controls." << endl << endl;
+            cout << "                        contains the audio using the default values of controls." << endl;
+            cout << "                        The audio is recorded during the default values test by a" << endl;
+            cout << "                        separated thread, so the encoding doesn't affect the timing." << endl;
+            cout << "                        It can't be used with --jobs on several plugins." << endl << endl;
+            cout << "  --seq-size BYTES      Size of the atom and event buffers, the ports which require a" << endl;
+            cout << "                        bigger one (rsz:minimumSize) get it, up to " << MAXIMUM_SEQ_SIZE << " bytes." << endl;
+            cout << "                        Default: " << EVENT_BUFFER_SIZE << endl << endl;
+            cout << "  --midi-output FILE    Write the MIDI events of the plugin outputs during the default" << endl;
+            cout << "                        values test to a Standard MIDI File (120 BPM). It can't be" << endl;
+            cout << "                        used with --jobs on several plugins." << endl << endl;
+            cout << "  --zero-copy           Connect the audio inputs of the plugin directly to the input" << endl;
+            cout << "                        signal at each cycle, instead of copying the signal to the" << endl;
+            cout << "                        inputs buffers." << endl << endl;
+            cout << "  --format FORMAT       Select the format of the results. Valid formats:" << endl;
+            cout << "                          table:      Human readable tables (default)" << endl;
+            cout << "                          json:       One JSON object per plugin (JSON lines)" << endl;
+            cout << "                          csv:        One row per test of each plugin" << endl << endl;
+            cout << "  --report FILE         Write the results to FILE using the format selected by" << endl;
+            cout << "                        --format, the tables are still printed on the screen." << endl << endl;
+            cout << "  --baseline FILE       Compare the results with a previous JSON report. The plugins" << endl;
+            cout << "                        run with the settings of the baseline and, if no URI is given," << endl;
+            cout << "                        all the plugins of the baseline are benchmarked. The exit" << endl;
+            cout << "                        status is " << EXIT_REGRESSION << " when any plugin regresses." << endl << endl;
+            cout << "  --threshold PCT       Minimum slowdown of the median cycle time, in percent, to" << endl;
+            cout << "                        consider a regression. Default: " << threshold << endl << endl;
+            cout << "  --alpha P             Significance level of the Mann-Whitney test of the cycle" << endl;
+            cout << "                        times. Default: " << alpha << endl << endl;
+            cout << "  -c, --clock SOURCE    Select the clock used to time the run cycles. The clock" << endl;
+            cout << "                        resolution and reading overhead are measured at startup" << endl;
+            cout << "                        and the overhead is discounted from the measurements." << endl;
+            cout << "                        Valid sources:" << endl;
+            cout << "                          monotonic:  Monotonic raw clock, not adjusted by NTP (default)" << endl;
+            cout << "                          cputime:    CPU time consumed by the benchmark thread" << endl;
+            cout << "                          tsc:        CPU cycle counter (invariant TSC or cntvct_el0)" << endl << endl;
+            cout << "  --deadline            Emulate the periods of JACK: the plugin runs once per period" << endl;
+            cout << "                        (frame-size / rate), woken at absolute deadlines, and the" << endl;
+            cout << "                        xruns, the wake up jitter and the slack are reported." << endl << endl;
+            cout << "  --ftz MODE            Flush the denormal numbers to zero (FTZ/DAZ on x86, FZ on ARM)" << endl;
+            cout << "                        during the tests. Valid modes:" << endl;
+            cout << "                          off:        Denormals are not flushed (default)" << endl;
+            cout << "                          on:         Denormals are flushed" << endl;
+            cout << "                          both:       Run the tests again flushing and compare" << endl << endl;
+            cout << "  --perf                Count the CPU cycles, instructions, cache and branch misses," << endl;
+            cout << "                        page faults and context switches of the tests (perf_event_open)." << endl;
+            cout << "                        The hardware counters may require a lower" << endl;
+            cout << "                        /proc/sys/kernel/perf_event_paranoid." << endl << endl;
+            cout << "  --rt-check            Detect the calls not realtime safe made by the plugin run" << endl;
+            cout << "                        function (allocations, mutex locks, file I/O, sleeps and" << endl;
+            cout << "                        waits) and print their count and the backtrace of the" << endl;
+            cout << "                        first one." << endl << endl;
+            cout << "  --blocks MODE         After the tests, split each cycle in several calls of the run" << endl;
+            cout << "                        function and report the cost per sample for each block length." << endl;
+            cout << "                        Valid modes:" << endl;
+            cout << "                          fixed:      No split, the test is not executed (default)" << endl;
+            cout << "                          random:     Random lengths" << endl;
+            cout << "                          pow2:       Power of two lengths, from the frame size down to 1" << endl;
+            cout << "                          L1,L2,...:  Repeated pattern of lengths" << endl << endl;
+            cout << "  --rt-priority N       Run the benchmark thread with SCHED_FIFO and priority N," << endl;
+            cout << "                        as the audio thread of JACK. Default: 0 (SCHED_OTHER)" << endl << endl;
+            cout << "  --cpu N               Pin the benchmark thread to the CPU N." << endl << endl;
+            cout << "  --worker-cpu N        Pin the worker thread of the plugin (LV2 worker) to the CPU N." << endl << endl;
+            cout << "  --mlock               Lock the memory of the process (mlockall), so the plugin doesn't" << endl;
+            cout << "                        page fault because of swapped pages." << endl << endl;
+            cout << "  --prefault            Touch the stack and the audio buffers before the tests, so the" << endl;
+            cout << "                        first cycles don't page fault." << endl << endl;
+            cout << "  -j, --jobs N          Benchmark N URIs in parallel, each one in its own process" << endl;
+            cout << "                        pinned to its own CPU. The results are printed in the" << endl;
+            cout << "                        order of the URIs. Default: 1" << endl << endl;
             cout << "  -V, --version         Print program version and exit." << endl << endl;
             cout << "  -h, --help            Print this help message and exit." << endl;
 
@@ -120,24 +820,111 @@ int main(int argc, char *argv[])
         }
     }
 
-    // run the benchmark
-    for (int i = 0; i < (argc - optind); i++) {
+    if (opts.cpu >= 0 && opts.jobs > 1) {
+        cout << "The --cpu option can't be used with --jobs, the jobs are pinned to their own CPU" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (opts.sweep == SWEEP_SEARCH && opts.budget == 0 && opts.time_limit <= 0.0) {
+        cout << "The search needs a budget or a time limit" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (report_path) {
+        opts.report = fopen(report_path, "w");
+        if (!opts.report) {
+            cout << "Can't open the report file " << report_path << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // the URIs of the baseline are used when none is given
+    std::vector<char*> uris(argv + optind, argv + argc);
+    if (baseline_path) {
         try {
-            Bench bench = Bench(argv[optind+i], rate, frame_size, n_frames, input_signal, output);
-            bench.full_test = full_test;
-            bench.process();
-            bench.print();
+            opts.baseline = new Baseline(baseline_path);
+            opts.baseline->threshold = threshold;
+            opts.baseline->alpha = alpha;
         }
         catch(exception& e) {
             cout << e.what() << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        if (uris.empty()) {
+            for (uint32_t i = 0; i < opts.baseline->entries.size(); i++) {
+                char *uri = (char *) opts.baseline->entries[i].uri.c_str();
+                bool repeated = false;
+                for (uint32_t j = 0; j < uris.size(); j++) {
+                    if (strcmp(uris[j], uri) == 0) repeated = true;
+                }
+                if (!repeated) uris.push_back(uri);
+            }
+        }
+    }
+
+    // the jobs would write the same file at once
+    if (opts.output && opts.jobs > 1 && uris.size() > 1) {
+        cout << "The --output option can't be used with --jobs on several plugins" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (opts.midi_output && opts.jobs > 1 && uris.size() > 1) {
+        cout << "The --midi-output option can't be used with --jobs on several plugins" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // the preset is of one plugin, the next one would overwrite it
+    if (opts.preset && uris.size() > 1) {
+        cout << "The --preset option can't be used with several plugins" << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // csv header is written once, before any plugin
+    Report(opts.report ? REPORT_TABLE : opts.format, stdout).begin();
+    if (opts.report) Report(opts.format, opts.report).begin();
+
+    // calibrate the clock once for all plugins
+    try {
+        opts.timer = new Timer(opts.clock_source);
+    }
+    catch(exception& e) {
+        cout << e.what() << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // run the benchmark
+    int n_uris = uris.size();
+    uint32_t regressions = 0;
+    if (opts.jobs > 1 && n_uris > 1) {
+        // load the plugins data before forking, so the jobs share it
+        Plugin::load_world();
+
+        JobPool pool(opts.jobs);
+        BenchJob job(&uris[0], &opts);
+        pool.run(&job, n_uris);
+        regressions = job.regressions;
+    }
+    else {
+        for (int i = 0; i < n_uris; i++) {
+            if (bench_uri(uris[i], &opts, opts.report) == EXIT_REGRESSION)
+                regressions++;
         }
     }
 
+    if (opts.report) fclose(opts.report);
+    delete opts.baseline;
+    delete opts.timer;
+
+    if (regressions > 0) {
+        cerr << regressions << " plugin(s) slower than the baseline" << endl;
+        return EXIT_REGRESSION;
+    }
+
     return 0;
 }
 
 // TODO: dump plugin test information when receive segfault
-// TODO: generate MIDI input for plugins that need it
 // TODO: allow to select the output unit
 // TODO(?): create option to print the controls values for max, min, def, best, worst
 // https://github.com/x42/midigen.lv2
@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#include "midi_gen.h"
+
+enum {
+    MIDI_NONE,
+    MIDI_NOTES,
+    MIDI_CHORDS,
+    MIDI_HELD,
+    MIDI_CC,
+    MIDI_BEND,
+    MIDI_RANDOM
+};
+
+// MIDI status bytes, channel 1
+#define NOTE_OFF        0x80
+#define NOTE_ON         0x90
+#define CONTROL_CHANGE  0xB0
+#define PITCH_BEND      0xE0
+
+static bool event_before(const midi_event_t& event, uint64_t time)
+{
+    return event.time < time;
+}
+
+static bool event_earlier(const midi_event_t& a, const midi_event_t& b)
+{
+    return a.time < b.time;
+}
+
+MidiGenerator::MidiGenerator(uint32_t sample_rate, const char *pattern, uint32_t voices, uint64_t length)
+{
+    this->sample_rate = sample_rate;
+    this->voices = voices < 1 ? 1 : (voices > MIDI_MAX_VOICES ? MIDI_MAX_VOICES : voices);
+    this->length = length > 0 ? length : 1;
+    this->position = 0;
+    this->muted = false;
+    this->dropped = 0;
+
+    // fixed seed, the random stream is the same on every run
+    rseed = 1;
+
+    mode = MIDI_NONE;
+    if (strcmp(pattern, "notes") == 0) mode = MIDI_NOTES;
+    else if (strcmp(pattern, "chords") == 0) mode = MIDI_CHORDS;
+    else if (strcmp(pattern, "held") == 0) mode = MIDI_HELD;
+    else if (strcmp(pattern, "cc") == 0) mode = MIDI_CC;
+    else if (strcmp(pattern, "bend") == 0) mode = MIDI_BEND;
+    else if (strcmp(pattern, "random") == 0) mode = MIDI_RANDOM;
+
+    const char *patterns_name[] = {"None", "Notes", "Chords", "Held Chord", "CC Sweep", "Pitch Bend Sweep", "Random"};
+    pattern_name = patterns_name[mode];
+
+    render();
+}
+
+uint32_t MidiGenerator::rand_int(void)
+{
+    // 31bit Park-Miller-Carta Pseudo-Random Number Generator, as the audio generator
+    uint32_t hi, lo;
+    lo = 16807 * (rseed & 0xffff);
+    hi = 16807 * (rseed >> 16);
+
+    lo += (hi & 0x7fff) << 16;
+    lo += hi >> 15;
+    lo = (lo & 0x7fffffff) + (lo >> 31);
+    return (rseed = lo);
+}
+
+void MidiGenerator::add(uint64_t time, uint8_t status, uint8_t data1, uint8_t data2)
+{
+    midi_event_t event;
+    event.time = time;
+    event.data[0] = status;
+    event.data[1] = data1;
+    event.data[2] = data2;
+    event.size = 3;
+    events.push_back(event);
+}
+
+void MidiGenerator::note_on(uint64_t time, uint8_t note, uint8_t velocity, uint64_t off)
+{
+    // retriggered notes are released first, and the oldest note is stolen
+    // when all the voices are playing
+    for (uint32_t i = 0; i < active.size(); i++) {
+        if (active[i].note == note) {
+            add(time, NOTE_OFF, note, 0);
+            active.erase(active.begin() + i);
+            break;
+        }
+    }
+
+    if (active.size() >= voices) {
+        uint32_t oldest = 0;
+        for (uint32_t i = 1; i < active.size(); i++) {
+            if (active[i].off < active[oldest].off) oldest = i;
+        }
+        add(time, NOTE_OFF, active[oldest].note, 0);
+        active.erase(active.begin() + oldest);
+    }
+
+    active_note_t playing = {note, off};
+    active.push_back(playing);
+    add(time, NOTE_ON, note, velocity);
+}
+
+void MidiGenerator::release_notes(uint64_t until)
+{
+    for (uint32_t i = 0; i < active.size();) {
+        if (active[i].off <= until) {
+            add(active[i].off, NOTE_OFF, active[i].note, 0);
+            active.erase(active.begin() + i);
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+void MidiGenerator::chord(uint64_t time, uint32_t root, uint64_t off)
+{
+    // stacked fifths from the middle C, wrapped in the piano range, so all
+    // the notes are distinct up to MIDI_MAX_VOICES
+    for (uint32_t i = 0; i < voices; i++) {
+        note_on(time, 21 + (39 + root + i * 7) % MIDI_MAX_VOICES, 100, off);
+    }
+}
+
+void MidiGenerator::render(void)
+{
+    const uint64_t note_period = sample_rate / 4 > 0 ? sample_rate / 4 : 1;
+    const uint64_t chord_period = sample_rate > 0 ? sample_rate : 1;
+
+    // the controllers are sent every 5ms, sweeping up and down in 2s
+    const uint64_t sweep_step = sample_rate / 200 > 0 ? sample_rate / 200 : 1;
+    const uint64_t sweep_period = 2 * chord_period;
+
+    const uint8_t scale[] = {60, 62, 64, 65, 67, 69, 71, 72};
+    const uint8_t controllers[] = {1, 7, 10, 11, 64, 71, 74};
+
+    uint64_t time = 0;
+    for (uint32_t i = 0; mode != MIDI_NONE && time < length; i++) {
+        release_notes(time);
+
+        uint64_t phase = time % sweep_period;
+        uint64_t triangle = phase < sweep_period / 2 ? phase : sweep_period - phase;
+
+        switch (mode) {
+        case MIDI_NOTES:
+            note_on(time, scale[i % 8], 100, time + note_period * 4 / 5);
+            time += note_period;
+            break;
+
+        case MIDI_CHORDS:
+            chord(time, i % 12, time + chord_period * 9 / 10);
+            time += chord_period;
+            break;
+
+        case MIDI_HELD:
+            // a single chord held during the whole sequence
+            chord(time, 0, UINT64_MAX);
+            time = length;
+            break;
+
+        case MIDI_CC:
+            // the chord is held while the controllers sweep
+            if (i == 0) chord(time, 0, UINT64_MAX);
+            add(time, CONTROL_CHANGE, 1, triangle * 127 / (sweep_period / 2));
+            add(time, CONTROL_CHANGE, 74, triangle * 127 / (sweep_period / 2));
+            time += sweep_step;
+            break;
+
+        case MIDI_BEND:
+            if (i == 0) chord(time, 0, UINT64_MAX);
+            {
+                uint32_t bend = triangle * 16383 / (sweep_period / 2);
+                add(time, PITCH_BEND, bend & 0x7f, (bend >> 7) & 0x7f);
+            }
+            time += sweep_step;
+            break;
+
+        case MIDI_RANDOM:
+            // 3 of 4 events are notes from 50ms to 1s long, the others controllers
+            if (rand_int() % 4) {
+                uint64_t duration = sample_rate / 20 + rand_int() % chord_period;
+                note_on(time, 36 + rand_int() % 61, 1 + rand_int() % 127, time + duration);
+            }
+            else {
+                add(time, CONTROL_CHANGE, controllers[rand_int() % sizeof(controllers)], rand_int() % 128);
+            }
+            time += 1 + rand_int() % (sample_rate / 10 > 0 ? sample_rate / 10 : 1);
+            break;
+        }
+    }
+
+    // all the notes are released before the sequence repeats
+    release_notes(length - 1);
+    for (uint32_t i = 0; i < active.size(); i++) {
+        add(length - 1, NOTE_OFF, active[i].note, 0);
+    }
+    active.clear();
+
+    std::stable_sort(events.begin(), events.end(), event_earlier);
+}
+
+void MidiGenerator::write_range(LV2_Evbuf_Iterator *iter, uint32_t type, uint64_t first, uint64_t last,
+                                uint64_t offset)
+{
+    std::vector<midi_event_t>::const_iterator event;
+    event = std::lower_bound(events.begin(), events.end(), first, event_before);
+
+    for (; event != events.end() && event->time < last; ++event) {
+        if (!lv2_evbuf_write(iter, event->time - first + offset, 0, type, event->size, event->data))
+            dropped++;
+    }
+}
+
+void MidiGenerator::write(LV2_Evbuf *evbuf, uint32_t type, uint32_t n_samples)
+{
+    if (events.empty())
+        return;
+
+    LV2_Evbuf_Iterator iter = lv2_evbuf_end(evbuf);
+    for (uint32_t i = 0; i < releases.size(); i++) {
+        if (!lv2_evbuf_write(&iter, 0, 0, type, releases[i].size, releases[i].data))
+            dropped++;
+    }
+
+    if (muted)
+        return;
+
+    uint64_t end = position + n_samples;
+    write_range(&iter, type, position, end < length ? end : length, 0);
+
+    // the sequence repeats, the cycle might cross its end
+    if (end > length)
+        write_range(&iter, type, 0, end - length, length - position);
+}
+
+void MidiGenerator::advance(uint32_t n_samples)
+{
+    position = (position + n_samples) % length;
+    releases.clear();
+}
+
+void MidiGenerator::rewind(void)
+{
+    queue_releases();
+    position = 0;
+    muted = false;
+}
+
+void MidiGenerator::release(void)
+{
+    queue_releases();
+    muted = true;
+}
+
+void MidiGenerator::queue_releases(void)
+{
+    // muted, the notes were already released
+    releases.clear();
+    if (muted)
+        return;
+
+    // the notes started before the current position and not released yet
+    bool playing[128] = {false};
+    std::vector<midi_event_t>::const_iterator event;
+    for (event = events.begin(); event != events.end() && event->time < position; ++event) {
+        uint8_t status = event->data[0] & 0xF0;
+        if (status == NOTE_ON && event->data[2] > 0)
+            playing[event->data[1]] = true;
+        else if (status == NOTE_ON || status == NOTE_OFF)
+            playing[event->data[1]] = false;
+    }
+
+    for (uint8_t note = 0; note < 128; note++) {
+        if (!playing[note])
+            continue;
+
+        midi_event_t release;
+        release.time = 0;
+        release.data[0] = NOTE_OFF;
+        release.data[1] = note;
+        release.data[2] = 0;
+        release.size = 3;
+        releases.push_back(release);
+    }
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIDI_GEN_H
+#define MIDI_GEN_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "lv2_evbuf.h"
+
+// distinct notes of the chords, the 88 keys of a piano
+#define MIDI_MAX_VOICES 88
+
+struct midi_event_t {
+    uint64_t time;
+    uint8_t data[3];
+    uint8_t size;
+};
+
+// MIDI events for instruments and MIDI effects, the whole sequence is rendered
+// in the constructor and written to the event buffers cycle by cycle, so the
+// generator cost is not measured along with the plugin
+class MidiGenerator {
+private:
+    int mode;
+    uint32_t sample_rate;
+
+    // rendered sequence and the position of the next cycle
+    std::vector<midi_event_t> events;
+    uint64_t length, position;
+
+    // note offs of the notes left playing by rewind, sent on the next cycle
+    std::vector<midi_event_t> releases;
+
+    // after release only the note offs are written, until rewind
+    bool muted;
+    void queue_releases(void);
+
+    // notes playing while rendering
+    struct active_note_t {
+        uint8_t note;
+        uint64_t off;
+    };
+    std::vector<active_note_t> active;
+
+    uint32_t rseed;
+    uint32_t rand_int(void);
+
+    void add(uint64_t time, uint8_t status, uint8_t data1, uint8_t data2);
+    void note_on(uint64_t time, uint8_t note, uint8_t velocity, uint64_t off);
+    void release_notes(uint64_t until);
+    void chord(uint64_t time, uint32_t root, uint64_t off);
+    void render(void);
+    void write_range(LV2_Evbuf_Iterator *iter, uint32_t type, uint64_t first, uint64_t last, uint64_t offset);
+
+public:
+    MidiGenerator(uint32_t sample_rate, const char *pattern, uint32_t voices, uint64_t length);
+
+    const char *pattern_name;
+    uint32_t voices;
+
+    // events not written because the buffer was full
+    uint64_t dropped;
+
+    // write the events of the next n_samples to the buffer, the same events
+    // are written to each MIDI input until advance is called
+    void write(LV2_Evbuf *evbuf, uint32_t type, uint32_t n_samples);
+    void advance(uint32_t n_samples);
+
+    // back to the start of the sequence, each test gets the same events and
+    // the notes playing at the current position are released
+    void rewind(void);
+
+    // release the notes playing and stop the sequence until rewind is called
+    void release(void);
+
+    uint64_t count(void) { return events.size(); }
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perf.h"
+
+PerfCounters::PerfCounters(void)
+{
+    for (uint32_t i = 0; i < PERF_COUNTERS; i++) {
+        fds[i] = -1;
+        values[i] = 0;
+    }
+
+    // all the counters in a single group, so they are enabled and disabled
+    // with a single call and read at once
+    leader = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+    fds[PERF_CYCLES] = leader;
+
+    // without PMU the software counters are still useful
+    if (leader < 0) {
+        leader = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, -1);
+        fds[PERF_PAGE_FAULTS] = leader;
+    }
+
+    if (leader < 0)
+        return;
+
+    if (fds[PERF_CYCLES] >= 0) {
+        fds[PERF_INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader);
+        fds[PERF_CACHE_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, leader);
+        fds[PERF_BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, leader);
+        fds[PERF_PAGE_FAULTS] = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, leader);
+    }
+
+    fds[PERF_CONTEXT_SWITCHES] = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, leader);
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (uint32_t i = 0; i < PERF_COUNTERS; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+}
+
+int PerfCounters::open_counter(uint32_t type, uint64_t config, int group)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group < 0 ? 1 : 0;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+
+    // the software events (page faults, context switches) happen in the
+    // kernel, they are only counted including the kernel
+    int fd = -1;
+    if (type == PERF_TYPE_SOFTWARE) {
+        // calling thread, any CPU
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+
+        // the context switches are never seen from the user space, reading
+        // zero would look like a result, so the counter is left unavailable
+        if (fd >= 0 || config == PERF_COUNT_SW_CONTEXT_SWITCHES)
+            return fd;
+    }
+
+    // only the user space, allowed with perf_event_paranoid up to 2
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+
+    return fd;
+}
+
+void PerfCounters::reset(void)
+{
+    if (leader >= 0)
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::enable(void)
+{
+    if (leader >= 0)
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::disable(void)
+{
+    if (leader >= 0)
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::read_values(void)
+{
+    if (leader < 0)
+        return;
+
+    // number of counters followed by the value and id of each counter
+    uint64_t data[1 + 2 * PERF_COUNTERS];
+    if (read(leader, data, sizeof(data)) < (ssize_t) sizeof(uint64_t))
+        return;
+
+    uint64_t ids[PERF_COUNTERS];
+    for (uint32_t i = 0; i < PERF_COUNTERS; i++) {
+        ids[i] = (uint64_t) -1;
+        if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_ID, &ids[i]);
+    }
+
+    for (uint64_t n = 0; n < data[0] && n < PERF_COUNTERS; n++) {
+        for (uint32_t i = 0; i < PERF_COUNTERS; i++) {
+            if (ids[i] == data[2 + 2 * n]) values[i] = data[1 + 2 * n];
+        }
+    }
+}
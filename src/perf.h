@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+
+enum perf_counter_t {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_CONTEXT_SWITCHES,
+    PERF_COUNTERS
+};
+
+// hardware and software counters of the calling thread (perf_event_open),
+// the counters which can't be opened are not available, e.g. because of
+// perf_event_paranoid or on virtual machines without a PMU
+class PerfCounters {
+private:
+    int fds[PERF_COUNTERS];
+    int leader;
+
+    int open_counter(uint32_t type, uint64_t config, int group);
+
+public:
+    PerfCounters(void);
+    ~PerfCounters();
+
+    void reset(void);
+    void enable(void);
+    void disable(void);
+    void read_values(void);
+
+    bool available(perf_counter_t counter) { return fds[counter] >= 0; }
+    bool any_available(void) { return leader >= 0; }
+
+    // counts since the last reset, only valid for the available counters
+    uint64_t values[PERF_COUNTERS];
+};
+
+#endif
@@ -16,9 +16,12 @@
  */
 
 #include "plugin.h"
+#include "rtcheck.h"
+#include "writer.h"
 #include <iostream>
 #include <cstdlib>
 #include <stdexcept>
+#include <algorithm>
 
 static bool g_initialized = false;
 static Lilv::World g_world;
@@ -93,6 +96,8 @@ PortGroup::PortGroup(Plugin* p, Lilv::Node type, uint32_t sample_count)
     Lilv::Node atom_chunk_node  = g_world.new_uri(LV2_ATOM__Chunk);
     Lilv::Node atom_seq_node    = g_world.new_uri(LV2_ATOM__Sequence);
     Lilv::Node event_node       = g_world.new_uri(LV2_EVENT__EventPort);
+    Lilv::Node midi_event_node  = g_world.new_uri(LV2_MIDI__MidiEvent);
+    Lilv::Node minimum_size_node = g_world.new_uri(LV2_RESIZE_PORT__minimumSize);
 
     for (uint32_t i = 0; i < p->num_ports; i++) {
         Lilv::Port port = p->plugin->get_port_by_index(i);
@@ -109,6 +114,7 @@ PortGroup::PortGroup(Plugin* p, Lilv::Node type, uint32_t sample_count)
             }
 
             // port values
+            port_data->index = i;
             port_data->min = p->ranges.min[i];
             port_data->max = p->ranges.max[i];
             port_data->def = p->ranges.def[i];
@@ -168,9 +174,29 @@ PortGroup::PortGroup(Plugin* p, Lilv::Node type, uint32_t sample_count)
 
             // check if is atom or event
             port_data->event_buffer = NULL;
+            port_data->event_buffer_size = port_data->event_high_water = 0;
+            port_data->is_midi = false;
             if (port.is_a(atom_node) || port.is_a(event_node)) {
+                port_data->is_midi = port.supports_event(midi_event_node);
+
+                // the sequence size, unless the plugin requires more
+                port_data->event_buffer_size = p->seq_size;
+                LilvNodes *minimum_size = port.get_value(minimum_size_node);
+                if (minimum_size) {
+                    const LilvNode *size_node = lilv_nodes_get_first(minimum_size);
+                    int size = size_node && lilv_node_is_int(size_node) ? lilv_node_as_int(size_node) : 0;
+                    if (size > MAXIMUM_SEQ_SIZE) {
+                        std::cerr << "warning: the port " << port_data->symbol << " requires "
+                                  << size << " bytes, using " << MAXIMUM_SEQ_SIZE << std::endl;
+                        size = MAXIMUM_SEQ_SIZE;
+                    }
+                    if (size > 0 && (uint32_t) size > port_data->event_buffer_size)
+                        port_data->event_buffer_size = size;
+                    lilv_nodes_free(minimum_size);
+                }
+
                 port_data->event_buffer =
-                    lv2_evbuf_new(EVENT_BUFFER_SIZE,
+                    lv2_evbuf_new(port_data->event_buffer_size,
                                   port.is_a(atom_node) ? LV2_EVBUF_ATOM : LV2_EVBUF_EVENT,
                                   Plugin::urid_map.map[atom_chunk_node.as_string()],
                                   Plugin::urid_map.map[atom_seq_node.as_string()]);
@@ -237,17 +263,19 @@ float PortGroup::get_value(uint32_t index)
     return inputs_by_index[index].value;
 }
 
-Plugin::Plugin(std::string uri, uint32_t sample_rate, uint32_t sample_count)
+Plugin::Plugin(std::string uri, uint32_t sample_rate, uint32_t sample_count, uint32_t min_block_length,
+               uint32_t seq_size)
     : instance(NULL)
 {
-    if (!g_initialized) {
-        g_world.load_all();
-        g_initialized = true;
-    }
+    load_world();
 
     this->uri = uri;
     this->sample_rate = sample_rate;
     this->sample_count = sample_count;
+    this->min_block_length = min_block_length ? min_block_length : sample_count;
+    this->seq_size = seq_size;
+    this->midi_input = NULL;
+    memset(&this->output_events, 0, sizeof(this->output_events));
 
     Lilv::Plugins plugins_list = g_world.get_all_plugins();
     Lilv::Node plugin_uri = g_world.new_uri(uri.c_str());
@@ -258,6 +286,14 @@ Plugin::Plugin(std::string uri, uint32_t sample_rate, uint32_t sample_count)
 
     plugin = &p;
 
+    // block length restrictions
+    Lilv::Nodes required_features = p.get_required_features();
+    Lilv::Node fixed_block_node = g_world.new_uri(LV2_BUF_SIZE__fixedBlockLength);
+    Lilv::Node pow2_block_node = g_world.new_uri(LV2_BUF_SIZE__powerOf2BlockLength);
+    fixed_block_length = required_features.contains(fixed_block_node);
+    power_of_2_block_length = required_features.contains(pow2_block_node);
+    lilv_nodes_free((LilvNodes*) required_features.me);
+
     // get plugin ranges
     num_ports = plugin->get_num_ports();
     ranges.min = new float[num_ports];
@@ -274,26 +310,27 @@ Plugin::Plugin(std::string uri, uint32_t sample_rate, uint32_t sample_count)
     features[n_features++] = &(urid_map.urid_map_feature);
     features[n_features++] = &(urid_map.urid_unmap_feature);
 
-    // options
-    LV2_Options_Option options[] = {
+    // options, they point to members so they stay valid during the instance life
+    LV2_Options_Option plugin_options[] = {
         {
             LV2_OPTIONS_INSTANCE, 0, urids.parameters_sampleRate,
-            sizeof(int32_t), urids.atom_Int, &sample_rate
+            sizeof(int32_t), urids.atom_Int, &this->sample_rate
         },
         {
             LV2_OPTIONS_INSTANCE, 0, urids.bufsize_minBlockLength,
-            sizeof(int32_t), urids.atom_Int, &sample_count
+            sizeof(int32_t), urids.atom_Int, &this->min_block_length
         },
         {
             LV2_OPTIONS_INSTANCE, 0, urids.bufsize_maxBlockLength,
-            sizeof(int32_t), urids.atom_Int, &sample_count
+            sizeof(int32_t), urids.atom_Int, &this->sample_count
         },
         {
             LV2_OPTIONS_INSTANCE, 0, urids.bufsize_sequenceSize,
-            sizeof(int32_t), urids.atom_Int, &seq_size
+            sizeof(int32_t), urids.atom_Int, &this->seq_size
         },
         { LV2_OPTIONS_INSTANCE, 0, 0, 0, 0, NULL }
     };
+    std::memcpy(options, plugin_options, sizeof(options));
     options_feature.URI = LV2_OPTIONS__options;
     options_feature.data = options;
     features[n_features++] = &options_feature;
@@ -340,6 +377,14 @@ Plugin::Plugin(std::string uri, uint32_t sample_rate, uint32_t sample_count)
     instance->activate();
 }
 
+void Plugin::load_world(void)
+{
+    if (!g_initialized) {
+        g_world.load_all();
+        g_initialized = true;
+    }
+}
+
 Plugin::~Plugin()
 {
     if (!instance)
@@ -372,17 +417,23 @@ void Plugin::run(uint32_t sample_count)
 {
     // event input ports
     for (uint32_t i = 0; i < atom->inputs_by_index.size(); i++) {
-        lv2_evbuf_reset(atom->inputs_by_index[i].event_buffer, true);
+        port_data_t *port = &atom->inputs_by_index[i];
+        lv2_evbuf_reset(port->event_buffer, true);
 
-        // TODO: write input MIDI events to test
+        if (midi_input && port->is_midi)
+            midi_input->write(port->event_buffer, urids.midi_MidiEvent, sample_count);
     }
 
+    if (midi_input)
+        midi_input->advance(sample_count);
+
     // reset event output ports
     for (uint32_t i = 0; i < atom->outputs_by_index.size(); i++) {
         lv2_evbuf_reset(atom->outputs_by_index[i].event_buffer, false);
     }
 
-    // process the plugin
+    // process the plugin, the calls not realtime safe are detected from here
+    rtcheck_arm();
     instance->run(sample_count);
 
     // notify the plugin the run cycle is finished
@@ -390,8 +441,71 @@ void Plugin::run(uint32_t sample_count)
         worker->emit_responses();
         if (work_iface->end_run) work_iface->end_run(instance->get_handle());
     }
+    rtcheck_disarm();
+}
+
+static bool event_earlier(const output_event_t& a, const output_event_t& b)
+{
+    return a.frame < b.frame;
+}
+
+void Plugin::read_events(uint64_t frame, MidiWriter *file)
+{
+    midi_events.clear();
+
+    // the inputs keep the events of the last run
+    for (uint32_t i = 0; i < atom->inputs_by_index.size(); i++) {
+        port_data_t *port = &atom->inputs_by_index[i];
+        uint32_t used = sizeof(LV2_Atom_Sequence_Body) + lv2_evbuf_get_size(port->event_buffer);
+        if (used > port->event_high_water) port->event_high_water = used;
+    }
+
+    for (uint32_t i = 0; i < atom->outputs_by_index.size(); i++) {
+        port_data_t *port = &atom->outputs_by_index[i];
+        LV2_Evbuf *evbuf = port->event_buffer;
+
+        LV2_Evbuf_Iterator iter;
+        for (iter = lv2_evbuf_begin(evbuf); lv2_evbuf_is_valid(iter); iter = lv2_evbuf_next(iter)) {
+            uint32_t frames, subframes, type, size;
+            uint8_t *data;
+            lv2_evbuf_get(iter, &frames, &subframes, &type, &size, &data);
+
+            output_events.events++;
+            output_events.bytes += size;
+
+            if (file && type == urids.midi_MidiEvent) {
+                output_event_t event;
+                event.frame = frames;
+                event.size = size;
+                event.data = data;
+                midi_events.push_back(event);
+            }
+        }
+
+        uint32_t used = sizeof(LV2_Atom_Sequence_Body) + lv2_evbuf_get_size(evbuf);
+        if (used > port->event_high_water) port->event_high_water = used;
+
+        // no room left for another MIDI event
+        if (used + sizeof(LV2_Atom_Event) + 8 > port->event_buffer_size)
+            output_events.full++;
+    }
+
+    // the file requires the frames in order, each port is in order but not
+    // the ports among them
+    std::stable_sort(midi_events.begin(), midi_events.end(), event_earlier);
+    for (uint32_t i = 0; i < midi_events.size(); i++) {
+        file->write(frame + midi_events[i].frame, midi_events[i].data, midi_events[i].size);
+    }
+}
+
+uint32_t Plugin::midi_inputs(void)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < atom->inputs_by_index.size(); i++) {
+        if (atom->inputs_by_index[i].is_midi) count++;
+    }
 
-    // TODO: write output MIDI events to test
+    return count;
 }
 
 int Plugin::work(uint32_t size, const void* data)
@@ -38,11 +38,13 @@
 #include <lv2/lv2plug.in/ns/ext/options/options.h>
 #include <lv2/lv2plug.in/ns/ext/buf-size/buf-size.h>
 #include <lv2/lv2plug.in/ns/ext/port-props/port-props.h>
+#include <lv2/lv2plug.in/ns/ext/resize-port/resize-port.h>
 #include <lv2/lv2plug.in/ns/ext/parameters/parameters.h>
 
 #include "urid_map.h"
 #include "worker.h"
 #include "lv2_evbuf.h"
+#include "midi_gen.h"
 
 #define MINIMUM_PRESET_LABEL "minimum"
 #define MAXIMUM_PRESET_LABEL "maximum"
@@ -50,9 +52,26 @@
 
 #define FEATURES_COUNT      5
 #define EVENT_BUFFER_SIZE   4096
+#define MINIMUM_SEQ_SIZE    64
+#define MAXIMUM_SEQ_SIZE    (16 * 1024 * 1024)
 
 class Plugin;
 class PortGroup;
+class MidiWriter;
+
+// events of the output ports counted by Plugin::read_events
+struct event_stats_t {
+    uint64_t events, bytes;
+
+    // runs which filled an output buffer, the plugin might have dropped events
+    uint64_t full;
+};
+
+// MIDI event of an output port, valid until the next run
+struct output_event_t {
+    uint32_t frame, size;
+    const uint8_t *data;
+};
 
 struct param_range_t {
     float *min, *max, *def;
@@ -65,6 +84,7 @@ struct scale_point_t {
 };
 
 struct port_data_t {
+    uint32_t index;
     const char *name, *symbol;
     float value, min, max, def;
     scale_point_t scale_points;
@@ -73,8 +93,14 @@ struct port_data_t {
     float *buffer;
     LV2_Evbuf *event_buffer;
 
+    // capacity of the event buffer, in bytes, and the most of it used by a cycle
+    uint32_t event_buffer_size, event_high_water;
+
     bool is_integer, is_logarithmic, is_enumeration, is_scale_point, is_toggled, is_trigger;
 
+    // atom or event port which supports MIDI events
+    bool is_midi;
+
     inline void write_buffer(float *buffer, uint32_t buffer_size=1)
     {
         std::memcpy(this->buffer, buffer, buffer_size * sizeof(float));
@@ -106,13 +132,26 @@ public:
 
 class Plugin : public Workee {
 public:
-    Plugin(std::string uri, uint32_t sample_rate, uint32_t sample_count);
+    Plugin(std::string uri, uint32_t sample_rate, uint32_t sample_count, uint32_t min_block_length=0,
+           uint32_t seq_size=EVENT_BUFFER_SIZE);
     ~Plugin();
 
     void run(uint32_t sample_count);
 
+    // count the output events of the last run, out of the timed region, the
+    // MIDI events are also written to the file at frame plus their time
+    void read_events(uint64_t frame, MidiWriter *file=NULL);
+    event_stats_t output_events;
+
+    // MIDI events of all the outputs of the last run, merged by frame
+    std::vector<output_event_t> midi_events;
+    static void load_world(void);
+
     std::string uri;
-    uint32_t sample_rate, sample_count;
+    uint32_t sample_rate, sample_count, min_block_length;
+
+    // block length restrictions required by the plugin (buf-size extension)
+    bool fixed_block_length, power_of_2_block_length;
 
     Lilv::Plugin* plugin;
     Lilv::Instance* instance;
@@ -124,6 +163,10 @@ public:
 
     LV2_Feature** features;
 
+    // events written to the MIDI inputs on each run, NULL for an empty sequence
+    MidiGenerator *midi_input;
+    uint32_t midi_inputs(void);
+
     // urid
     static URIDMap urid_map;
     struct URIDs {
@@ -149,9 +192,13 @@ public:
     };
     static URIDs urids;
 
-    // options
+    // options, the plugin might keep the pointer to them
     LV2_Feature options_feature;
-    int32_t seq_size;
+    LV2_Options_Option options[5];
+
+    // size of the sequence buffers, the ports which require a bigger one
+    // (rsz:minimumSize) get it
+    uint32_t seq_size;
 
     // worker
     LV2_Feature work_schedule_feature;
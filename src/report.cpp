@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "report.h"
+
+Report::Report(report_format_t format, FILE *stream)
+{
+    this->format = format;
+    this->stream = stream;
+}
+
+void Report::begin(void)
+{
+    if (format == REPORT_CSV) {
+        fprintf(stream, "uri,rate,frame_size,n_frames,signal,test,total,average,jack_load,"
+                        "p50,p90,p99,p999,max,stddev,worst_cycle,trials,disturbed,load_median,"
+                        "load_ci_low,load_ci_high,ipc,cache_misses_per_sample,branch_misses_per_sample,"
+                        "page_faults_per_cycle,context_switches_per_cycle,events,event_bytes,full_cycles,"
+                        "events_per_second,baseline_median,current_median,"
+                        "delta,p_value,regression,controls\n");
+        fflush(stream);
+    }
+}
+
+void Report::write_string(const char *str)
+{
+    fputc('"', stream);
+    for (const char *c = str; *c; c++) {
+        switch (*c) {
+        case '"':  fputs("\\\"", stream); break;
+        case '\\': fputs("\\\\", stream); break;
+        case '\n': fputs("\\n", stream); break;
+        case '\t': fputs("\\t", stream); break;
+        default:
+            if ((unsigned char) *c < 0x20) fprintf(stream, "\\u%04x", *c);
+            else fputc(*c, stream);
+        }
+    }
+    fputc('"', stream);
+}
+
+// RFC 4180 quoting, the quotes inside the field are doubled
+void Report::write_csv_string(const char *str)
+{
+    fputc('"', stream);
+    for (const char *c = str; *c; c++) {
+        if (*c == '"') fputc('"', stream);
+        fputc(*c, stream);
+    }
+    fputc('"', stream);
+}
+
+// the values not available are left empty
+void Report::write_csv_number(double value)
+{
+    if (isfinite(value))
+        fprintf(stream, "%.9g", value);
+}
+
+void Report::write_number(double value)
+{
+    // JSON has no representation for inf and nan
+    if (isfinite(value)) fprintf(stream, "%.9g", value);
+    else fprintf(stream, "null");
+}
+
+void Report::write_json_test(const char *name, bench_info_t *var, bool last)
+{
+    fprintf(stream, "\"%s\":{\"total\":", name);
+    write_number(var->total);
+    fprintf(stream, ",\"average\":");
+    write_number(var->average);
+    fprintf(stream, ",\"jack_load\":");
+    write_number(var->jack_load);
+    fprintf(stream, ",\"p50\":");
+    write_number(var->p50);
+    fprintf(stream, ",\"p90\":");
+    write_number(var->p90);
+    fprintf(stream, ",\"p99\":");
+    write_number(var->p99);
+    fprintf(stream, ",\"p999\":");
+    write_number(var->p999);
+    fprintf(stream, ",\"max\":");
+    write_number(var->max);
+    fprintf(stream, ",\"stddev\":");
+    write_number(var->stddev);
+    fprintf(stream, ",\"worst_cycle\":%u", var->worst_cycle);
+    fprintf(stream, ",\"ipc\":");
+    write_number(var->ipc);
+    fprintf(stream, ",\"cache_misses_per_sample\":");
+    write_number(var->cache_misses);
+    fprintf(stream, ",\"branch_misses_per_sample\":");
+    write_number(var->branch_misses);
+    fprintf(stream, ",\"page_faults_per_cycle\":");
+    write_number(var->page_faults);
+    fprintf(stream, ",\"context_switches_per_cycle\":");
+    write_number(var->context_switches);
+    fprintf(stream, ",\"events\":%llu,\"event_bytes\":%llu,\"full_cycles\":%llu,\"events_per_second\":",
+            (unsigned long long) var->events, (unsigned long long) var->event_bytes,
+            (unsigned long long) var->full_cycles);
+    write_number(var->events_per_second);
+    fprintf(stream, ",\"trials\":%u,\"disturbed\":%u,\"load_median\":", var->trials, var->disturbed);
+    write_number(var->load_median);
+    fprintf(stream, ",\"load_ci_low\":");
+    write_number(var->load_ci_low);
+    fprintf(stream, ",\"load_ci_high\":");
+    write_number(var->load_ci_high);
+
+    if (!var->cycles.empty()) {
+        fprintf(stream, ",\"cycles\":[");
+        for (uint32_t i = 0; i < var->cycles.size(); i++) {
+            if (i > 0) fputc(',', stream);
+            write_number(var->cycles[i]);
+        }
+        fputc(']', stream);
+    }
+
+    fprintf(stream, ",\"controls\":{");
+    std::map<uint32_t,port_data_t>::iterator it;
+    for (it = var->plugin_preset.begin(); it != var->plugin_preset.end(); ++it) {
+        if (it != var->plugin_preset.begin()) fputc(',', stream);
+        write_string(it->second.symbol);
+        fputc(':', stream);
+        write_number(it->second.value);
+    }
+    fprintf(stream, "}}%s", last ? "" : ",");
+}
+
+void Report::write_csv_test(Bench *bench, const char *name, bench_info_t *var,
+                            const std::vector<comparison_t> *comparisons)
+{
+    write_csv_string(bench->plugin->uri.c_str());
+    fprintf(stream, ",%u,%u,%u,", bench->sample_rate, bench->frame_size, bench->n_frames);
+    write_csv_string(bench->signal);
+    fprintf(stream, ",%s,", name);
+    fprintf(stream, "%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%u,", var->total, var->average,
+            var->jack_load, var->p50, var->p90, var->p99, var->p999, var->max, var->stddev,
+            var->worst_cycle);
+    fprintf(stream, "%u,%u,", var->trials, var->disturbed);
+    write_csv_number(var->load_median);
+    fputc(',', stream);
+    write_csv_number(var->load_ci_low);
+    fputc(',', stream);
+    write_csv_number(var->load_ci_high);
+    fputc(',', stream);
+
+    // perf counters, empty without --perf
+    double counters[] = {var->ipc, var->cache_misses, var->branch_misses, var->page_faults, var->context_switches};
+    for (uint32_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        write_csv_number(counters[i]);
+        fputc(',', stream);
+    }
+
+    fprintf(stream, "%llu,%llu,%llu,", (unsigned long long) var->events, (unsigned long long) var->event_bytes,
+            (unsigned long long) var->full_cycles);
+    write_csv_number(var->events_per_second);
+    fputc(',', stream);
+
+    // the baseline columns are empty when the test wasn't compared
+    const comparison_t *comparison = NULL;
+    for (uint32_t i = 0; comparisons && i < comparisons->size(); i++) {
+        if (strcmp((*comparisons)[i].test, name) == 0) comparison = &(*comparisons)[i];
+    }
+    if (comparison) {
+        fprintf(stream, "%.9g,%.9g,%.9g,%.9g,%d,", comparison->baseline, comparison->current,
+                comparison->delta, comparison->p_value, comparison->regression ? 1 : 0);
+    }
+    else {
+        fprintf(stream, ",,,,,");
+    }
+    fputc('"', stream);
+
+    std::map<uint32_t,port_data_t>::iterator it;
+    for (it = var->plugin_preset.begin(); it != var->plugin_preset.end(); ++it) {
+        if (it != var->plugin_preset.begin()) fputc(';', stream);
+        fprintf(stream, "%s=%g", it->second.symbol, it->second.value);
+    }
+    fprintf(stream, "\"\n");
+}
+
+void Report::write_comparisons(const std::vector<comparison_t> *comparisons)
+{
+    if (format == REPORT_JSON) {
+        fprintf(stream, ",\"baseline\":{");
+        for (uint32_t i = 0; i < comparisons->size(); i++) {
+            const comparison_t *comparison = &(*comparisons)[i];
+            fprintf(stream, "%s\"%s\":{\"baseline_median\":", i > 0 ? "," : "", comparison->test);
+            write_number(comparison->baseline);
+            fprintf(stream, ",\"current_median\":");
+            write_number(comparison->current);
+            fprintf(stream, ",\"delta\":");
+            write_number(comparison->delta);
+            fprintf(stream, ",\"p_value\":");
+            write_number(comparison->p_value);
+            fprintf(stream, ",\"regression\":%s}", comparison->regression ? "true" : "false");
+        }
+        fprintf(stream, "}");
+        return;
+    }
+
+    if (comparisons->empty()) {
+        fprintf(stream, "Baseline: no results of this plugin\n");
+        return;
+    }
+
+    fprintf(stream, "%12s%13s%13s%11s%11s%12s\n", "TestName", "Baseline(s)", "Current(s)", "Delta(%)",
+            "P-Value", "Result");
+    for (uint32_t i = 0; i < comparisons->size(); i++) {
+        const comparison_t *comparison = &(*comparisons)[i];
+        const char *name = comparison->test;
+        if (strcmp(name, "min") == 0) name = "MinValues";
+        else if (strcmp(name, "def") == 0) name = "DefValues";
+        else if (strcmp(name, "max") == 0) name = "MaxValues";
+
+        fprintf(stream, "%12s%13.8f%13.8f%+11.2f%11.2g%12s\n", name, comparison->baseline,
+                comparison->current, comparison->delta, comparison->p_value,
+                comparison->regression ? "REGRESSION" : "ok");
+    }
+}
+
+void Report::write(Bench *bench, const std::vector<comparison_t> *comparisons)
+{
+    if (format == REPORT_TABLE) {
+        bench->print(stream);
+        if (comparisons)
+            write_comparisons(comparisons);
+    }
+    else if (format == REPORT_JSON) {
+        fprintf(stream, "{\"uri\":");
+        write_string(bench->plugin->uri.c_str());
+        fprintf(stream, ",\"rate\":%u,\"frame_size\":%u,\"n_frames\":%u,\"signal\":",
+                bench->sample_rate, bench->frame_size, bench->n_frames);
+        write_string(bench->signal);
+        fprintf(stream, ",\"clock\":");
+        write_string(bench->timer->source_name);
+        fprintf(stream, ",\"zero_copy\":%s", bench->zero_copy ? "true" : "false");
+        if (bench->midi) {
+            fprintf(stream, ",\"midi\":{\"pattern\":");
+            write_string(bench->midi_pattern);
+            fprintf(stream, ",\"voices\":%u,\"events\":%llu,\"dropped\":%llu}", bench->midi->voices,
+                    (unsigned long long) bench->midi->count(), (unsigned long long) bench->midi->dropped);
+        }
+
+        const char *ftz_modes[] = {"off", "on", "both"};
+        fprintf(stream, ",\"ftz\":\"%s\"", ftz_modes[bench->ftz]);
+        if (bench->ftz == FTZ_BOTH) {
+            fprintf(stream, ",\"ftz_on\":{\"min\":");
+            write_number(bench->min_ftz.jack_load);
+            fprintf(stream, ",\"def\":");
+            write_number(bench->def_ftz.jack_load);
+            fprintf(stream, ",\"max\":");
+            write_number(bench->max_ftz.jack_load);
+            fputc('}', stream);
+        }
+        fprintf(stream, ",\"warmup_cycles\":%u,\"cold_cycle\":", bench->warmup_cycles);
+        write_number(bench->cold_cycle);
+
+        if (bench->deadline) {
+            deadline_info_t *info = &bench->deadline_info;
+            fprintf(stream, ",\"deadline\":{\"periods\":%u,\"xruns\":%u,\"period\":", info->periods,
+                    info->xruns);
+            write_number(info->period);
+
+            const char *names[] = {"jitter", "slack"};
+            double *stats[] = {info->jitter, info->slack};
+            for (uint32_t i = 0; i < 2; i++) {
+                fprintf(stream, ",\"%s\":{\"min\":", names[i]);
+                write_number(stats[i][0]);
+                fprintf(stream, ",\"p1\":");
+                write_number(stats[i][1]);
+                fprintf(stream, ",\"p50\":");
+                write_number(stats[i][2]);
+                fprintf(stream, ",\"p99\":");
+                write_number(stats[i][3]);
+                fprintf(stream, ",\"max\":");
+                write_number(stats[i][4]);
+                fputc('}', stream);
+            }
+            fputc('}', stream);
+        }
+
+        if (bench->blocks != BLOCKS_FIXED) {
+            const char *modes[] = {"fixed", "random", "pow2", "pattern"};
+            fprintf(stream, ",\"blocks\":{\"mode\":\"%s\",\"jack_load\":", modes[bench->blocks]);
+            write_number(bench->blocks_jack_load);
+            fprintf(stream, ",\"lengths\":[");
+
+            bool first = true;
+            for (uint32_t i = 0; i < bench->block_stats.size(); i++) {
+                block_stats_t *stats = &bench->block_stats[i];
+                if (stats->calls == 0)
+                    continue;
+
+                fprintf(stream, "%s{\"min\":%u,\"max\":%u,\"calls\":%llu,\"per_call\":", first ? "" : ",",
+                        stats->min_length, stats->max_length, (unsigned long long) stats->calls);
+                write_number(stats->time / stats->calls);
+                fprintf(stream, ",\"per_sample\":");
+                write_number(stats->time / stats->samples);
+                fputc('}', stream);
+                first = false;
+            }
+            fprintf(stream, "]}");
+        }
+
+        std::map<uint32_t,port_data_t> *groups[] = {&bench->plugin->atom->inputs_by_index,
+                                                     &bench->plugin->atom->outputs_by_index};
+        fprintf(stream, ",\"seq_size\":%u,\"event_ports\":[", bench->plugin->seq_size);
+        for (uint32_t g = 0, n = 0; g < 2; g++) {
+            for (uint32_t i = 0; i < groups[g]->size(); i++, n++) {
+                port_data_t *port = &(*groups[g])[i];
+                fprintf(stream, "%s{\"symbol\":", n > 0 ? "," : "");
+                write_string(port->symbol);
+                fprintf(stream, ",\"input\":%s,\"size\":%u,\"high_water\":%u}", g == 0 ? "true" : "false",
+                        port->event_buffer_size, port->event_high_water);
+            }
+        }
+        fputc(']', stream);
+
+        if (!bench->polyphony_points.empty()) {
+            fprintf(stream, ",\"polyphony\":{\"base\":");
+            write_number(bench->polyphony_base);
+            fprintf(stream, ",\"per_voice\":");
+            write_number(bench->polyphony_per_voice);
+            fprintf(stream, ",\"max_voices\":");
+            write_number(bench->max_voices);
+            fprintf(stream, ",\"points\":[");
+            for (uint32_t i = 0; i < bench->polyphony_points.size(); i++) {
+                polyphony_point_t *point = &bench->polyphony_points[i];
+                fprintf(stream, "%s{\"voices\":%u,\"average\":", i > 0 ? "," : "", point->voices);
+                write_number(point->average);
+                fprintf(stream, ",\"jack_load\":");
+                write_number(point->jack_load);
+                fputc('}', stream);
+            }
+            fprintf(stream, "]}");
+        }
+
+        if (bench->rt_check) {
+            const rtcheck_report_t *rt_report = &bench->rt_report;
+            fprintf(stream, ",\"rt_check\":{\"violations\":%llu,\"bytes\":%llu",
+                    (unsigned long long) rtcheck_violations(rt_report), (unsigned long long) rt_report->bytes);
+            for (int i = 0; i < RTCHECK_CALLS; i++) {
+                fprintf(stream, ",\"%s\":%llu", rtcheck_call_name(i), (unsigned long long) rt_report->counts[i]);
+            }
+
+            if (rt_report->first >= 0) {
+                fprintf(stream, ",\"first\":\"%s\",\"backtrace\":[", rtcheck_call_name(rt_report->first));
+                std::vector<std::string> frames = rtcheck_backtrace(rt_report);
+                for (uint32_t i = 0; i < frames.size(); i++) {
+                    if (i > 0) fputc(',', stream);
+                    write_string(frames[i].c_str());
+                }
+                fputc(']', stream);
+            }
+            fputc('}', stream);
+        }
+
+        if (bench->full_test) {
+            fprintf(stream, ",\"combinations_tested\":%llu,\"combinations_total\":%llu",
+                    (unsigned long long) bench->n_combinations_tested,
+                    (unsigned long long) bench->count_combinations(true));
+        }
+
+        fprintf(stream, ",\"tests\":{");
+        write_json_test("min", &bench->min, false);
+        write_json_test("def", &bench->def, false);
+        write_json_test("max", &bench->max, !bench->full_test);
+        if (bench->full_test) {
+            write_json_test("best", &bench->smaller, false);
+            write_json_test("worst", &bench->bigger, true);
+        }
+        fprintf(stream, "}");
+
+        if (comparisons)
+            write_comparisons(comparisons);
+
+        fprintf(stream, "}\n");
+    }
+    else if (format == REPORT_CSV) {
+        write_csv_test(bench, "min", &bench->min, comparisons);
+        write_csv_test(bench, "def", &bench->def, comparisons);
+        write_csv_test(bench, "max", &bench->max, comparisons);
+        if (bench->full_test) {
+            write_csv_test(bench, "best", &bench->smaller, NULL);
+            write_csv_test(bench, "worst", &bench->bigger, NULL);
+        }
+    }
+
+    fflush(stream);
+}
+
+void Report::write_error(const char *uri, const char *error)
+{
+    if (format == REPORT_JSON) {
+        fprintf(stream, "{\"uri\":");
+        write_string(uri);
+        fprintf(stream, ",\"error\":");
+        write_string(error);
+        fprintf(stream, "}\n");
+    }
+    else if (format == REPORT_CSV) {
+        // the error takes the place of the test name
+        write_csv_string(uri);
+        fprintf(stream, ",,,,,error,,,,,,,,,,,,,,,,,,,,,,,,,,,,,,");
+        write_csv_string(error);
+        fputc('\n', stream);
+    }
+    else {
+        fprintf(stream, "Plugin: %s\n%s\n", uri, error);
+    }
+
+    fflush(stream);
+}
+
+void Report::write_scaling(const char *uri, Scaling *scaling)
+{
+    if (format == REPORT_JSON) {
+        fprintf(stream, "{\"uri\":");
+        write_string(uri);
+        fprintf(stream, ",\"scaling\":{\"points\":[");
+        for (uint32_t i = 0; i < scaling->points.size(); i++) {
+            scaling_point_t *point = &scaling->points[i];
+            fprintf(stream, "%s{\"rate\":%u,\"frame_size\":%u,\"average\":", i > 0 ? "," : "",
+                    point->rate, point->frame_size);
+            write_number(point->average);
+            fprintf(stream, ",\"jack_load\":");
+            write_number(point->jack_load);
+            fputc('}', stream);
+        }
+        fprintf(stream, "],\"fits\":[");
+        for (uint32_t i = 0; i < scaling->fits.size(); i++) {
+            scaling_fit_t *fit = &scaling->fits[i];
+            fprintf(stream, "%s{\"rate\":%u,\"per_call\":", i > 0 ? "," : "", fit->rate);
+            write_number(fit->per_call);
+            fprintf(stream, ",\"per_sample\":");
+            write_number(fit->per_sample);
+            fprintf(stream, ",\"r2\":");
+            write_number(fit->r2);
+            fputc('}', stream);
+        }
+        fprintf(stream, "]}}\n");
+    }
+    else if (format == REPORT_CSV) {
+        // the scaling is derived from the def rows
+        return;
+    }
+    else {
+        fprintf(stream, "Scaling: %s\n", uri);
+        fprintf(stream, "%12s%11s%13s%13s%17s\n", "Rate", "FrameSize", "AvrTime(s)", "JackLoad(%)",
+                "Time/Sample(ns)");
+        for (uint32_t i = 0; i < scaling->points.size(); i++) {
+            scaling_point_t *point = &scaling->points[i];
+            fprintf(stream, "%12u%11u%13.8f%13f%17.2f\n", point->rate, point->frame_size, point->average,
+                    point->jack_load, point->average / point->frame_size * 1e9);
+        }
+
+        for (uint32_t i = 0; i < scaling->fits.size(); i++) {
+            scaling_fit_t *fit = &scaling->fits[i];
+            fprintf(stream, "%12u Per call: %.3fus, Per sample: %.3fns (R^2 %.3f)\n", fit->rate,
+                    fit->per_call * 1e6, fit->per_sample * 1e9, fit->r2);
+        }
+    }
+
+    fflush(stream);
+}
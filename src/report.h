@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdio.h>
+
+#include "bm.h"
+#include "baseline.h"
+#include "scaling.h"
+
+enum report_format_t {
+    REPORT_TABLE,
+    REPORT_JSON,
+    REPORT_CSV
+};
+
+// structured results, one record per plugin (JSON lines or CSV rows), each
+// record is flushed as soon as the plugin finishes
+class Report {
+private:
+    void write_json_test(const char *name, bench_info_t *var, bool last);
+    void write_csv_test(Bench *bench, const char *name, bench_info_t *var,
+                        const std::vector<comparison_t> *comparisons);
+    void write_comparisons(const std::vector<comparison_t> *comparisons);
+    void write_string(const char *str);
+    void write_csv_string(const char *str);
+    void write_csv_number(double value);
+    void write_number(double value);
+
+public:
+    Report(report_format_t format, FILE *stream);
+
+    void begin(void);
+    void write(Bench *bench, const std::vector<comparison_t> *comparisons=NULL);
+    void write_error(const char *uri, const char *error);
+    void write_scaling(const char *uri, Scaling *scaling);
+
+    report_format_t format;
+    FILE *stream;
+};
+
+#endif
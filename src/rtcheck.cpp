@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// the wrappers of the fortified headers would clash with the interposed functions
+#undef _FORTIFY_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+
+#include "rtcheck.h"
+
+// frames of the backtrace belonging to the detector (violation and the
+// interposed function)
+#define RTCHECK_SKIP_FRAMES 2
+
+// the glibc allocator, called directly since dlsym itself allocates
+extern "C" {
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t n, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void __libc_free(void *ptr);
+    void *__libc_memalign(size_t alignment, size_t size);
+}
+
+// next definition of an interposed function, resolved on the first call
+#define NEXT(name) \
+    static __typeof__(&name) next_##name = NULL; \
+    if (!next_##name) next_##name = (__typeof__(&name)) dlsym(RTLD_NEXT, #name)
+
+static __thread bool armed = false;
+static bool enabled = false;
+static rtcheck_report_t report;
+
+static const char *call_names[RTCHECK_CALLS] = {
+    "malloc", "calloc", "realloc", "free", "memalign", "mutex_lock", "open", "read", "write", "sleep", "wait"
+};
+
+static void __attribute__((noinline)) violation(rtcheck_call_t call, size_t bytes)
+{
+    // the detector itself must not be detected
+    armed = false;
+
+    report.counts[call]++;
+    report.bytes += bytes;
+
+    if (report.first < 0) {
+        report.first = call;
+        report.backtrace_size = backtrace(report.backtrace, RTCHECK_BACKTRACE_DEPTH);
+    }
+
+    armed = true;
+}
+
+void rtcheck_enable(bool enable)
+{
+    // the first backtrace loads the unwinder, which allocates
+    if (enable) {
+        void *frames[RTCHECK_BACKTRACE_DEPTH];
+        backtrace(frames, RTCHECK_BACKTRACE_DEPTH);
+    }
+
+    enabled = enable;
+    rtcheck_reset();
+}
+
+void rtcheck_reset(void)
+{
+    memset(&report, 0, sizeof(report));
+    report.first = -1;
+}
+
+void rtcheck_arm(void)
+{
+    armed = enabled;
+}
+
+void rtcheck_disarm(void)
+{
+    armed = false;
+}
+
+const rtcheck_report_t *rtcheck_get_report(void)
+{
+    return &report;
+}
+
+void rtcheck_merge(const rtcheck_report_t *other)
+{
+    for (int i = 0; i < RTCHECK_CALLS; i++) {
+        report.counts[i] += other->counts[i];
+    }
+    report.bytes += other->bytes;
+
+    // the shards are forked, so the addresses of the backtrace are the same
+    if (report.first < 0 && other->first >= 0) {
+        report.first = other->first;
+        report.backtrace_size = other->backtrace_size;
+        memcpy(report.backtrace, other->backtrace, sizeof(report.backtrace));
+    }
+}
+
+uint64_t rtcheck_violations(const rtcheck_report_t *report)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < RTCHECK_CALLS; i++) {
+        total += report->counts[i];
+    }
+
+    return total;
+}
+
+const char *rtcheck_call_name(int call)
+{
+    if (call < 0 || call >= RTCHECK_CALLS)
+        return "none";
+
+    return call_names[call];
+}
+
+std::vector<std::string> rtcheck_backtrace(const rtcheck_report_t *report)
+{
+    std::vector<std::string> frames;
+    if (report->backtrace_size <= RTCHECK_SKIP_FRAMES)
+        return frames;
+
+    int size = report->backtrace_size - RTCHECK_SKIP_FRAMES;
+    char **symbols = backtrace_symbols(report->backtrace + RTCHECK_SKIP_FRAMES, size);
+    if (!symbols)
+        return frames;
+
+    for (int i = 0; i < size; i++) {
+        frames.push_back(symbols[i]);
+    }
+
+    free(symbols);
+    return frames;
+}
+
+/*
+ * interposed functions
+ */
+
+extern "C" void *malloc(size_t size) __THROW
+{
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_MALLOC, size);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size) __THROW
+{
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_CALLOC, n * size);
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) __THROW
+{
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_REALLOC, size);
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr) __THROW
+{
+    // free(NULL) doesn't touch the allocator
+    if (__builtin_expect(armed, 0) && ptr) violation(RTCHECK_FREE, 0);
+    __libc_free(ptr);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size) __THROW
+{
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_MEMALIGN, size);
+
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    void *mem = __libc_memalign(alignment, size);
+    if (!mem)
+        return ENOMEM;
+
+    *ptr = mem;
+    return 0;
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size) __THROW
+{
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_MEMALIGN, size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t *mutex) __THROW
+{
+    NEXT(pthread_mutex_lock);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_MUTEX_LOCK, 0);
+    return next_pthread_mutex_lock(mutex);
+}
+
+extern "C" int open(const char *path, int flags, ...)
+{
+    NEXT(open);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_OPEN, 0);
+
+    mode_t mode = 0;
+    if (__OPEN_NEEDS_MODE(flags)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+
+    return next_open(path, flags, mode);
+}
+
+// the large file variants are the ones called by the plugins built with
+// _FILE_OFFSET_BITS=64 on 32 bits systems
+extern "C" int open64(const char *path, int flags, ...)
+{
+    NEXT(open64);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_OPEN, 0);
+
+    mode_t mode = 0;
+    if (__OPEN_NEEDS_MODE(flags)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+
+    return next_open64(path, flags, mode);
+}
+
+extern "C" int openat(int dirfd, const char *path, int flags, ...)
+{
+    NEXT(openat);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_OPEN, 0);
+
+    mode_t mode = 0;
+    if (__OPEN_NEEDS_MODE(flags)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+
+    return next_openat(dirfd, path, flags, mode);
+}
+
+extern "C" int openat64(int dirfd, const char *path, int flags, ...)
+{
+    NEXT(openat64);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_OPEN, 0);
+
+    mode_t mode = 0;
+    if (__OPEN_NEEDS_MODE(flags)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+
+    return next_openat64(dirfd, path, flags, mode);
+}
+
+extern "C" FILE *fopen(const char *path, const char *mode)
+{
+    NEXT(fopen);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_OPEN, 0);
+    return next_fopen(path, mode);
+}
+
+extern "C" FILE *fopen64(const char *path, const char *mode)
+{
+    NEXT(fopen64);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_OPEN, 0);
+    return next_fopen64(path, mode);
+}
+
+extern "C" ssize_t read(int fd, void *buf, size_t count)
+{
+    NEXT(read);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_READ, 0);
+    return next_read(fd, buf, count);
+}
+
+extern "C" ssize_t write(int fd, const void *buf, size_t count)
+{
+    NEXT(write);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_WRITE, 0);
+    return next_write(fd, buf, count);
+}
+
+extern "C" int nanosleep(const struct timespec *req, struct timespec *rem)
+{
+    NEXT(nanosleep);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_SLEEP, 0);
+    return next_nanosleep(req, rem);
+}
+
+extern "C" int usleep(useconds_t usec)
+{
+    NEXT(usleep);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_SLEEP, 0);
+    return next_usleep(usec);
+}
+
+// blocking waits for another thread, e.g. the worker or a disk streaming thread
+extern "C" int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+    NEXT(pthread_cond_wait);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_WAIT, 0);
+    return next_pthread_cond_wait(cond, mutex);
+}
+
+extern "C" int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                                      const struct timespec *abstime)
+{
+    NEXT(pthread_cond_timedwait);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_WAIT, 0);
+    return next_pthread_cond_timedwait(cond, mutex, abstime);
+}
+
+extern "C" int sem_wait(sem_t *sem)
+{
+    NEXT(sem_wait);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_WAIT, 0);
+    return next_sem_wait(sem);
+}
+
+extern "C" int sem_timedwait(sem_t *sem, const struct timespec *abstime)
+{
+    NEXT(sem_timedwait);
+    if (__builtin_expect(armed, 0)) violation(RTCHECK_WAIT, 0);
+    return next_sem_timedwait(sem, abstime);
+}
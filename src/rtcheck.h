@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RTCHECK_H
+#define RTCHECK_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// frames of the backtrace of the first offender
+#define RTCHECK_BACKTRACE_DEPTH 32
+
+// calls not allowed in the realtime thread, interposed in the lv2bm binary
+enum rtcheck_call_t {
+    RTCHECK_MALLOC,
+    RTCHECK_CALLOC,
+    RTCHECK_REALLOC,
+    RTCHECK_FREE,
+    RTCHECK_MEMALIGN,
+    RTCHECK_MUTEX_LOCK,
+    RTCHECK_OPEN,
+    RTCHECK_READ,
+    RTCHECK_WRITE,
+    RTCHECK_SLEEP,
+    RTCHECK_WAIT,
+    RTCHECK_CALLS
+};
+
+struct rtcheck_report_t {
+    uint64_t counts[RTCHECK_CALLS];
+
+    // bytes requested by the allocations
+    uint64_t bytes;
+
+    // call and backtrace of the first offender, first is -1 when none
+    int first;
+    void *backtrace[RTCHECK_BACKTRACE_DEPTH];
+    int backtrace_size;
+};
+
+// enable the detection, the calls are only counted while the calling thread
+// is armed, disarmed the interposed functions just check a thread local flag
+void rtcheck_enable(bool enable);
+void rtcheck_reset(void);
+
+void rtcheck_arm(void);
+void rtcheck_disarm(void);
+
+const rtcheck_report_t *rtcheck_get_report(void);
+
+// add the calls detected by another process (the full test shards)
+void rtcheck_merge(const rtcheck_report_t *other);
+uint64_t rtcheck_violations(const rtcheck_report_t *report);
+const char *rtcheck_call_name(int call);
+
+// symbols of the backtrace of the first offender, from its caller on
+std::vector<std::string> rtcheck_backtrace(const rtcheck_report_t *report);
+
+#endif
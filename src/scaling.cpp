@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include "scaling.h"
+
+void Scaling::add(Bench *bench)
+{
+    scaling_point_t point;
+    point.rate = bench->sample_rate;
+    point.frame_size = bench->frame_size;
+    point.average = bench->def.average;
+    point.jack_load = bench->def.jack_load;
+    points.push_back(point);
+}
+
+void Scaling::fit(void)
+{
+    // the per call overhead and the per sample cost don't depend on the rate
+    // in theory, but the plugin might change its processing with the rate
+    std::vector<uint32_t> rates;
+    for (uint32_t i = 0; i < points.size(); i++) {
+        bool found = false;
+        for (uint32_t j = 0; j < rates.size(); j++) {
+            if (rates[j] == points[i].rate) found = true;
+        }
+        if (!found) rates.push_back(points[i].rate);
+    }
+
+    fits.clear();
+    for (uint32_t r = 0; r < rates.size(); r++) {
+        double n = 0.0, sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0, syy = 0.0;
+        for (uint32_t i = 0; i < points.size(); i++) {
+            if (points[i].rate != rates[r]) continue;
+
+            double x = points[i].frame_size, y = points[i].average;
+            n += 1.0;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+            syy += y * y;
+        }
+
+        // at least two different frame sizes are needed
+        double det = n * sxx - sx * sx;
+        if (n < 2.0 || det <= 0.0)
+            continue;
+
+        scaling_fit_t fit;
+        fit.rate = rates[r];
+        fit.n_points = n;
+        fit.per_sample = (n * sxy - sx * sy) / det;
+        fit.per_call = (sy - fit.per_sample * sx) / n;
+
+        double var_y = n * syy - sy * sy;
+        double cov = n * sxy - sx * sy;
+        fit.r2 = var_y > 0.0 ? (cov * cov) / (det * var_y) : 1.0;
+
+        fits.push_back(fit);
+    }
+}
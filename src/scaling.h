@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCALING_H
+#define SCALING_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "bm.h"
+
+// result of the default values test for a rate and frame size
+struct scaling_point_t {
+    uint32_t rate, frame_size;
+    double average, jack_load;
+};
+
+// least squares fit of the cycle time as per_call + per_sample * frame_size
+struct scaling_fit_t {
+    uint32_t rate, n_points;
+    double per_call, per_sample, r2;
+};
+
+// how the cost of a plugin grows with the frame size
+class Scaling {
+public:
+    void add(Bench *bench);
+    void fit(void);
+
+    std::vector<scaling_point_t> points;
+    std::vector<scaling_fit_t> fits;
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "timer.h"
+
+#define CALIBRATION_TIME_NS     50000000ULL
+#define MEASUREMENT_SAMPLES     1000
+
+Timer::Timer(const char *source)
+{
+    clock_id = CLOCK_MONOTONIC;
+    tick_period = 1e-9;
+    overhead_ticks = 0;
+
+    if (strcmp(source, "monotonic") == 0) {
+        this->source = TIMER_MONOTONIC;
+#ifdef CLOCK_MONOTONIC_RAW
+        // not affected by NTP adjustments
+        clock_id = CLOCK_MONOTONIC_RAW;
+#endif
+        source_name = "monotonic";
+    }
+    else if (strcmp(source, "cputime") == 0) {
+        this->source = TIMER_CPUTIME;
+        clock_id = CLOCK_THREAD_CPUTIME_ID;
+        source_name = "cputime";
+    }
+    else if (strcmp(source, "tsc") == 0) {
+        this->source = TIMER_TSC;
+        source_name = "tsc";
+
+        if (!calibrate_tsc()) {
+            std::cerr << "warning: invariant cycle counter not available, using monotonic clock" << std::endl;
+            this->source = TIMER_MONOTONIC;
+#ifdef CLOCK_MONOTONIC_RAW
+            clock_id = CLOCK_MONOTONIC_RAW;
+#endif
+            source_name = "monotonic";
+        }
+    }
+    else {
+        throw std::invalid_argument(std::string("Invalid clock source: ") + source);
+    }
+
+    measure();
+}
+
+bool Timer::calibrate_tsc(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // invariant TSC: CPUID.80000007H:EDX[8]
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+        return false;
+#elif defined(__aarch64__)
+    // the generic timer has its frequency published by the firmware
+    uint64_t freq;
+    __asm__ __volatile__ ("mrs %0, cntfrq_el0" : "=r" (freq));
+    if (freq == 0)
+        return false;
+#else
+    return false;
+#endif
+
+#ifdef TIMER_HAS_TSC
+    // count the ticks elapsed in a known interval of the monotonic clock
+    struct timespec start_t, end_t;
+    clock_gettime(CLOCK_MONOTONIC, &start_t);
+    uint64_t start_tsc = read_tsc();
+
+    uint64_t elapsed_ns;
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &end_t);
+        elapsed_ns = (end_t.tv_sec - start_t.tv_sec) * 1000000000ULL + end_t.tv_nsec - start_t.tv_nsec;
+    } while (elapsed_ns < CALIBRATION_TIME_NS);
+
+    uint64_t end_tsc = read_tsc();
+    if (end_tsc <= start_tsc)
+        return false;
+
+    tick_period = (elapsed_ns * 1e-9) / (double) (end_tsc - start_tsc);
+    return true;
+#endif
+}
+
+void Timer::measure(void)
+{
+    // the cost of reading the timer is the smallest interval between two reads
+    uint64_t min_overhead = UINT64_MAX;
+    for (int i = 0; i < MEASUREMENT_SAMPLES; i++) {
+        uint64_t start = now();
+        uint64_t end = now();
+        if (end - start < min_overhead) min_overhead = end - start;
+    }
+    overhead_ticks = min_overhead;
+    overhead = overhead_ticks * tick_period;
+
+    // the resolution is the smallest non null increment of the timer
+    uint64_t min_step = UINT64_MAX;
+    for (int i = 0; i < MEASUREMENT_SAMPLES; i++) {
+        uint64_t start = now(), end;
+        while ((end = now()) == start) {}
+        if (end - start < min_step) min_step = end - start;
+    }
+    resolution = min_step * tick_period;
+}
+
+double Timer::elapsed(uint64_t start, uint64_t end)
+{
+    // discount the time spent reading the timer itself
+    uint64_t ticks = end - start;
+    ticks = ticks > overhead_ticks ? ticks - overhead_ticks : 0;
+    return ticks * tick_period;
+}
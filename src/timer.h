@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TIMER_HAS_TSC
+#elif defined(__aarch64__)
+#define TIMER_HAS_TSC
+#endif
+
+enum timer_source_t {
+    TIMER_MONOTONIC,
+    TIMER_CPUTIME,
+    TIMER_TSC
+};
+
+// time source used to measure the run cycles, the readings are done in
+// ticks and converted to seconds only after the measurement
+class Timer {
+private:
+    timer_source_t source;
+    clockid_t clock_id;
+    double tick_period;
+    uint64_t overhead_ticks;
+
+    static inline uint64_t read_tsc(void);
+    bool calibrate_tsc(void);
+    void measure(void);
+
+public:
+    Timer(const char *source);
+
+    inline uint64_t now(void)
+    {
+#ifdef TIMER_HAS_TSC
+        if (source == TIMER_TSC)
+            return read_tsc();
+#endif
+
+        struct timespec ts;
+        clock_gettime(clock_id, &ts);
+        return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    double elapsed(uint64_t start, uint64_t end);
+
+    const char *source_name;
+    double resolution, overhead;
+};
+
+inline uint64_t Timer::read_tsc(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // the fence avoids the counter being read before previous instructions complete
+    _mm_lfence();
+    uint64_t tsc = __rdtsc();
+    _mm_lfence();
+    return tsc;
+#elif defined(__aarch64__)
+    uint64_t cnt;
+    __asm__ __volatile__ ("isb; mrs %0, cntvct_el0" : "=r" (cnt) :: "memory");
+    return cnt;
+#else
+    return 0;
+#endif
+}
+
+#endif
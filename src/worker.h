@@ -71,6 +71,11 @@ public:
 	*/
 	void emit_responses();
 
+	/**
+	   The worker thread, e.g. to set its CPU affinity.
+	*/
+	pthread_t thread() const { return _thread; }
+
 private:
 	static void* run(void *data);
 	/**
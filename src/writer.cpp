@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <unistd.h>
+
+#include "writer.h"
+
+// amount of audio the ring can hold, in seconds
+#define RING_DURATION   10
+
+// MIDI file ticks per quarter note, at 120 BPM (500000us per quarter note)
+#define SMF_DIVISION    960
+#define SMF_TEMPO       500000
+
+AudioWriter::AudioWriter(const char *path, uint32_t n_channels, uint32_t sample_rate, uint32_t block_size)
+    : sem(0)
+{
+    this->n_channels = n_channels;
+    this->block_size = block_size;
+    stalls = 0;
+    g_atomic_int_set(&exit, 0);
+
+    sndfile = SndfileHandle(path, SFM_WRITE, SF_FORMAT_FLAC | SF_FORMAT_PCM_24, n_channels, sample_rate);
+
+    // the channels are queued one after another, the writer thread interleaves them
+    uint32_t ring_size = n_channels * sample_rate * RING_DURATION;
+    if (ring_size < 2 * n_channels * block_size) ring_size = 2 * n_channels * block_size;
+
+    ring = new RingBuffer<float>(ring_size);
+    block = new float[n_channels * block_size];
+    interleaved = new float[n_channels * block_size];
+
+    pthread_create(&thread, NULL, AudioWriter::run, this);
+}
+
+AudioWriter::~AudioWriter()
+{
+    g_atomic_int_set(&exit, 1);
+    sem.post();
+    pthread_join(thread, NULL);
+
+    delete ring;
+    delete[] block;
+    delete[] interleaved;
+}
+
+bool AudioWriter::is_open(void)
+{
+    return sndfile;
+}
+
+void AudioWriter::write(float **buffers)
+{
+    uint32_t block_samples = n_channels * block_size;
+
+    if (ring->write_space() < block_samples) {
+        stalls++;
+        while (ring->write_space() < block_samples) {
+            usleep(1000);
+        }
+    }
+
+    for (uint32_t i = 0; i < n_channels; i++) {
+        ring->write(buffers[i], block_size);
+    }
+
+    sem.post();
+}
+
+void AudioWriter::write_block(void)
+{
+    ring->read(block, n_channels * block_size);
+
+    for (uint32_t i = 0; i < block_size; i++) {
+        for (uint32_t j = 0; j < n_channels; j++) {
+            interleaved[i * n_channels + j] = block[j * block_size + i];
+        }
+    }
+
+    sndfile.write(interleaved, n_channels * block_size);
+}
+
+void* AudioWriter::run(void *data)
+{
+    AudioWriter *writer = (AudioWriter *) data;
+    uint32_t block_samples = writer->n_channels * writer->block_size;
+
+    while (true) {
+        writer->sem.wait();
+
+        while (writer->ring->read_space() >= block_samples) {
+            writer->write_block();
+        }
+
+        if (g_atomic_int_get(&writer->exit))
+            break;
+    }
+
+    return NULL;
+}
+
+MidiWriter::MidiWriter(const char *path, uint32_t sample_rate)
+{
+    this->sample_rate = sample_rate;
+    last_tick = 0;
+    file = fopen(path, "wb");
+
+    // tempo meta event
+    const uint8_t tempo[] = {0x00, 0xFF, 0x51, 0x03, (SMF_TEMPO >> 16) & 0xFF, (SMF_TEMPO >> 8) & 0xFF,
+                             SMF_TEMPO & 0xFF};
+    track.insert(track.end(), tempo, tempo + sizeof(tempo));
+}
+
+MidiWriter::~MidiWriter()
+{
+    if (!file)
+        return;
+
+    // end of track meta event
+    const uint8_t end[] = {0x00, 0xFF, 0x2F, 0x00};
+    track.insert(track.end(), end, end + sizeof(end));
+
+    uint32_t length = track.size();
+    const uint8_t header[] = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, SMF_DIVISION >> 8, SMF_DIVISION & 0xFF,
+                              'M', 'T', 'r', 'k', (uint8_t) (length >> 24), (uint8_t) (length >> 16),
+                              (uint8_t) (length >> 8), (uint8_t) length};
+
+    fwrite(header, 1, sizeof(header), file);
+    fwrite(&track[0], 1, track.size(), file);
+    fclose(file);
+}
+
+bool MidiWriter::is_open(void)
+{
+    return file != NULL;
+}
+
+void MidiWriter::write_variable(uint32_t value)
+{
+    // variable length quantity, 7 bits per byte, most significant first
+    uint8_t bytes[5];
+    int n = 0;
+    do {
+        bytes[n++] = value & 0x7F;
+        value >>= 7;
+    } while (value > 0);
+
+    while (n > 0) {
+        n--;
+        track.push_back(bytes[n] | (n > 0 ? 0x80 : 0x00));
+    }
+}
+
+void MidiWriter::write(uint64_t frame, const uint8_t *data, uint32_t size)
+{
+    // channel messages (0x80 to 0xEF) and SysEx (0xF0)
+    if (size == 0 || data[0] < 0x80 || data[0] > 0xF0)
+        return;
+
+    // two quarter notes per second
+    uint64_t tick = frame * 2 * SMF_DIVISION / sample_rate;
+    uint32_t delta = tick > last_tick ? tick - last_tick : 0;
+    last_tick = tick > last_tick ? tick : last_tick;
+
+    write_variable(delta);
+    if (data[0] == 0xF0) {
+        // the SysEx length doesn't include the status byte
+        track.push_back(0xF0);
+        write_variable(size - 1);
+        track.insert(track.end(), data + 1, data + size);
+    }
+    else {
+        track.insert(track.end(), data, data + size);
+    }
+}
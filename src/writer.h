@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2017 Ricardo Crudo <ricardo.crudo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <vector>
+#include <sndfile.hh>
+
+#include "pbd/ringbuffer.h"
+#include "pbd/semaphore.h"
+
+/**
+   Writes audio blocks to a FLAC file from its own thread.
+*/
+class AudioWriter {
+public:
+    AudioWriter(const char *path, uint32_t n_channels, uint32_t sample_rate, uint32_t block_size);
+    ~AudioWriter();
+
+    /**
+       Queue a block of audio, one buffer per channel (audio thread).
+       It waits only when the writer thread falls behind the whole ring.
+    */
+    void write(float **buffers);
+
+    bool is_open(void);
+
+    // how many blocks the audio thread had to wait for the writer thread
+    uint32_t stalls;
+
+private:
+    static void* run(void *data);
+    void write_block(void);
+
+    SndfileHandle sndfile;
+    uint32_t n_channels, block_size;
+
+    RingBuffer<float> *ring;
+    float *block, *interleaved;
+
+    PBD::Semaphore sem;
+    gint exit;
+    pthread_t thread;
+};
+
+/**
+   Writes MIDI events to a Standard MIDI File (format 0, 120 BPM).
+   The events are kept in memory and the file is written when destroyed.
+*/
+class MidiWriter {
+public:
+    MidiWriter(const char *path, uint32_t sample_rate);
+    ~MidiWriter();
+
+    /**
+       Add a MIDI message at the given frame, the frames must not go back.
+       Only the channel messages and the SysEx are written.
+    */
+    void write(uint64_t frame, const uint8_t *data, uint32_t size);
+
+    bool is_open(void);
+
+private:
+    void write_variable(uint32_t value);
+
+    FILE *file;
+    uint32_t sample_rate;
+    uint64_t last_tick;
+    std::vector<uint8_t> track;
+};
+
+#endif
@@ -26,9 +26,45 @@ run_test $PLUGIN
 run_test $PLUGIN --rate 44100
 run_test $PLUGIN --frame-size 256
 run_test $PLUGIN --n-frames 750
+run_test $PLUGIN --rate 44100,48000,96000 --frame-size 32,64,128,256
+run_test $PLUGIN --warmup 100
+run_test $PLUGIN --warmup auto --full-test --jobs 2
+run_test $PLUGIN --repeat 5
 run_test $PLUGIN --full-test
+run_test $PLUGIN --full-test --jobs 2 --print-combinations
+run_test $PLUGIN --full-test --sweep covering
+run_test $PLUGIN --full-test --sweep covering --strength 3
+run_test $PLUGIN --full-test --sweep search --budget 50 --preset /tmp/worst.ttl
+run_test $PLUGIN --full-test --sweep search --budget 0 --time-limit 5
 run_test $PLUGIN --input sweep
+run_test $PLUGIN --input decay --ftz both
+run_test $PLUGIN --input fade --ftz on
+run_test $PLUGIN --input burst
+run_test $PLUGIN --midi notes
+run_test $PLUGIN --midi random --voices 16 --format json
+run_test $PLUGIN --midi none
+run_test $PLUGIN --polyphony 16 --format json
+run_test $PLUGIN --midi held --polyphony 6
+run_test $PLUGIN --midi notes --midi-output /tmp/sample.mid
+run_test $PLUGIN --midi cc --seq-size 256 --format json
 run_test $PLUGIN --output /tmp/sample.flac
+run_test $PLUGIN --zero-copy
+run_test $PLUGIN --format json
+run_test $PLUGIN --format csv --full-test
+run_test $PLUGIN $PLUGIN --jobs 2 --format json --report /tmp/report.json
+run_test --baseline /tmp/report.json
+run_test $PLUGIN --baseline /tmp/report.json --threshold 10 --alpha 0.05 --format csv
+run_test $PLUGIN --deadline --frame-size 64
+run_test $PLUGIN --perf
+run_test $PLUGIN --rt-check --format json
+run_test $PLUGIN --perf --repeat 3 --format json
+run_test $PLUGIN --blocks random
+run_test $PLUGIN --blocks pow2 --full-test --jobs 2
+run_test $PLUGIN --blocks 1,17,64
+run_test $PLUGIN --rt-priority 70 --cpu 0 --worker-cpu 1 --mlock --prefault
+run_test $PLUGIN --clock cputime
+run_test $PLUGIN --clock tsc
+run_test $PLUGIN $PLUGIN --jobs 2
 run_test $PLUGIN --version
 run_test $PLUGIN --help
 run_test $PLUGIN -r 44100 -f 256 -n 750 -i sawtooth -o /tmp/sample.flac